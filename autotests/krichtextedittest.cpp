@@ -20,8 +20,16 @@
 #include "krichtextedittest.h"
 
 #include <krichtextedit.h>
+#include <krichtextwidget.h>
 #include <kcolorscheme.h>
-
+#include <kselectaction.h>
+
+#include <QAction>
+#include <QFontDatabase>
+#include <QMenu>
+#include <QMimeData>
+#include <QScopedPointer>
+#include <QSignalSpy>
 #include <QTest>
 #include <QTextCursor>
 #include <QTextList>
@@ -29,6 +37,14 @@
 
 QTEST_MAIN(KRichTextEditTest)
 
+// Gives access to the paste handling without going through the clipboard
+class PasteTextWidget : public KRichTextWidget
+{
+public:
+    using KRichTextWidget::createMimeDataFromSelection;
+    using KRichTextWidget::insertFromMimeData;
+};
+
 void KRichTextEditTest::testLinebreaks()
 {
     KRichTextEdit edit;
@@ -111,6 +127,177 @@ void KRichTextEditTest::testUpdateLinkRemove()
     QCOMPARE(charFormat.underlineStyle(), QTextCharFormat::NoUnderline);
 }
 
+void KRichTextEditTest::testSelectLinkText()
+{
+    KRichTextEdit edit;
+    edit.setHtml(QStringLiteral("<p>Go to <a href=\"http://www.kde.org\">the <b>KDE</b> site</a> now</p>"
+                                "<p><a href=\"http://a.example\">first</a></p>"
+                                "<p><a href=\"http://a.example\">second</a> and more</p>"));
+
+    // A link made of several fragments
+    QTextCursor cursor(edit.document());
+    cursor.setPosition(8);
+    edit.selectLinkText(&cursor);
+    QCOMPARE(cursor.selectedText(), QStringLiteral("the KDE site"));
+
+    // A link continuing into the next block
+    cursor = QTextCursor(edit.document()->findBlockByNumber(2));
+    cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, 2);
+    edit.selectLinkText(&cursor);
+    QCOMPARE(cursor.selectedText(), QStringLiteral("first") + QChar(QChar::ParagraphSeparator) + QStringLiteral("second"));
+
+    // Not on a link, the word is selected
+    cursor.setPosition(1);
+    edit.selectLinkText(&cursor);
+    QCOMPARE(cursor.selectedText(), QStringLiteral("Go"));
+}
+
+void KRichTextEditTest::testLinks()
+{
+    KRichTextEdit edit;
+    edit.setHtml(QStringLiteral("<p>Go to <a href=\"http://www.kde.org\">KDE</a> or "
+                                "<a href=\"http://evil.example\">http://bank.example</a></p>"));
+
+    QVector<KRichTextEdit::Link> links = edit.links();
+    QCOMPARE(links.size(), 2);
+    QCOMPARE(links.at(0).position, 6);
+    QCOMPARE(links.at(0).length, 3);
+    QCOMPARE(links.at(0).url, QStringLiteral("http://www.kde.org"));
+    QCOMPARE(links.at(0).text, QStringLiteral("KDE"));
+    QCOMPARE(links.at(1).url, QStringLiteral("http://evil.example"));
+    QCOMPARE(links.at(1).text, QStringLiteral("http://bank.example"));
+
+    QCOMPARE(edit.links(0, 6).size(), 0);
+    QCOMPARE(edit.links(0, 7).size(), 1);
+    QCOMPARE(edit.links(8, 100).size(), 2);
+
+    // Typing before and inside a link updates the index
+    QTextCursor cursor(edit.document());
+    cursor.insertText(QStringLiteral("Please "));
+    cursor.setPosition(14);
+    cursor.insertText(QStringLiteral("the "), cursor.charFormat());
+    links = edit.links();
+    QCOMPARE(links.size(), 2);
+    QCOMPARE(links.at(0).position, 13);
+    QCOMPARE(links.at(0).text, QStringLiteral("Kthe DE"));
+
+    // Removing a link
+    cursor.setPosition(links.at(0).position);
+    cursor.setPosition(links.at(0).position + links.at(0).length, QTextCursor::KeepAnchor);
+    cursor.setCharFormat(QTextCharFormat());
+    links = edit.links();
+    QCOMPARE(links.size(), 1);
+    QCOMPARE(links.at(0).url, QStringLiteral("http://evil.example"));
+
+    // Replacing all text
+    edit.setPlainText(QStringLiteral("No links"));
+    QVERIFY(edit.links().isEmpty());
+}
+
+void KRichTextEditTest::testAutoLinking()
+{
+    KRichTextEdit edit;
+    edit.setAutoLinkingEnabled(true);
+    QVERIFY(edit.isAutoLinkingEnabled());
+
+    // A typed URL is linked once it is complete
+    QTest::keyClicks(&edit, QStringLiteral("see www.kde.org"));
+    QTest::qWait(0);
+    QVERIFY(edit.links().isEmpty());
+    QTest::keyClicks(&edit, QStringLiteral(". "));
+    QTRY_COMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).url, QStringLiteral("http://www.kde.org"));
+    QCOMPARE(edit.links().at(0).text, QStringLiteral("www.kde.org"));
+    QCOMPARE(edit.textMode(), KRichTextEdit::Rich);
+
+    // Inserted text is linked right away
+    edit.insertPlainText(QStringLiteral("Mail dev@kde.org"));
+    QTRY_COMPARE(edit.links().size(), 2);
+    QCOMPARE(edit.links().at(1).url, QStringLiteral("mailto:dev@kde.org"));
+
+    // Links whose text is no URL anymore are removed
+    QTextCursor cursor(edit.document());
+    cursor.setPosition(4);
+    cursor.setPosition(8, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    QTRY_COMPARE(edit.links().size(), 1);
+
+    // Manual links are left alone
+    edit.clear();
+    cursor = QTextCursor(edit.document());
+    QTextCharFormat format;
+    format.setAnchor(true);
+    format.setAnchorHref(QStringLiteral("http://www.kde.org"));
+    cursor.insertText(QStringLiteral("https://example.com"), format);
+    cursor.insertText(QStringLiteral(" and more"), QTextCharFormat());
+    QTest::qWait(0);
+    QCOMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).url, QStringLiteral("http://www.kde.org"));
+
+    // A new document is followed as well
+    QTextDocument *adopted = new QTextDocument;
+    adopted->setPlainText(QStringLiteral("Some text"));
+    edit.adoptDocument(adopted);
+    QVERIFY(edit.links().isEmpty());
+    edit.moveCursor(QTextCursor::End);
+    edit.insertPlainText(QStringLiteral(" at https://kde.org"));
+    QTRY_COMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).url, QStringLiteral("https://kde.org"));
+
+    QTextDocument *other = new QTextDocument(&edit);
+    edit.setDocument(other);
+    edit.insertPlainText(QStringLiteral("Mail dev@kde.org"));
+    QTRY_COMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).url, QStringLiteral("mailto:dev@kde.org"));
+}
+
+void KRichTextEditTest::testChunkedPasteAutoLinking()
+{
+    PasteTextWidget edit;
+    edit.setAutoLinkingEnabled(true);
+    edit.insertPlainText(QStringLiteral("Links:\n"));
+    QString pasted;
+    for (int i = 0; i < 10000; ++i) {
+        pasted += QStringLiteral("Line %1 at https://www.kde.org/%1\n").arg(i);
+    }
+    QMimeData mimeData;
+    mimeData.setText(pasted);
+
+    // Adding the links does not interrupt the paste
+    edit.setChunkedPasteThreshold(1000);
+    QSignalSpy finishedSpy(&edit, &KTextEdit::chunkedPasteFinished);
+    edit.insertFromMimeData(&mimeData);
+    QVERIFY(edit.isChunkedPasteActive());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toBool(), false);
+    QCOMPARE(edit.toPlainText(), QStringLiteral("Links:\n") + pasted);
+    QTRY_COMPARE(edit.links().size(), 10000);
+    QCOMPARE(edit.links().at(9999).url, QStringLiteral("https://www.kde.org/9999"));
+}
+
+void KRichTextEditTest::testSwitchToPlainText()
+{
+    KRichTextEdit edit;
+    edit.setHtml(QStringLiteral("<p><b>Bold</b> text</p><ul><li>one</li><li>two</li></ul>"));
+    edit.enableRichTextMode();
+    QTextDocument *doc = edit.document();
+    const int blockCount = doc->blockCount();
+    const QString plainText = edit.toPlainText();
+    const int undoSteps = doc->availableUndoSteps();
+
+    edit.switchToPlainText();
+    QCOMPARE(edit.textMode(), KRichTextEdit::Plain);
+    QTRY_VERIFY(!doc->findBlockByNumber(1).textList());
+
+    QCOMPARE(doc->blockCount(), blockCount);
+    QCOMPARE(edit.toPlainText(), plainText);
+    QVERIFY(!doc->findBlockByNumber(2).textList());
+    QTextCursor cursor(doc);
+    cursor.setPosition(2);
+    QCOMPARE(cursor.charFormat().fontWeight(), static_cast<int>(QFont::Normal));
+    QCOMPARE(doc->availableUndoSteps(), undoSteps + 1);
+}
+
 void KRichTextEditTest::testHTMLLineBreaks()
 {
     KRichTextEdit edit;
@@ -245,3 +432,406 @@ void KRichTextEditTest::testHTMLUnorderedLists()
 
 }
 
+void KRichTextEditTest::testMarkdown()
+{
+    const QString markdown = QStringLiteral(
+                                 "# Title\n"
+                                 "\n"
+                                 "Some **bold** and *italic* text with a [link](https://kde.org).\n"
+                                 "\n"
+                                 "- one\n"
+                                 "- two\n"
+                                 "    - nested\n");
+
+    KRichTextEdit edit;
+    edit.setMarkdownText(markdown);
+    QCOMPARE(edit.textMode(), KRichTextEdit::Rich);
+    QCOMPARE(edit.toPlainText(), QStringLiteral("Title\nSome bold and italic text with a link.\none\ntwo\nnested"));
+
+    QTextDocument *doc = edit.document();
+    QTextCursor cursor(doc->findBlockByNumber(1));
+    cursor.setPosition(cursor.block().position() + 6);
+    QCOMPARE(cursor.charFormat().fontWeight(), static_cast<int>(QFont::Bold));
+    cursor.setPosition(cursor.block().position() + cursor.block().text().indexOf(QLatin1String("link")) + 1);
+    QCOMPARE(cursor.charFormat().anchorHref(), QStringLiteral("https://kde.org"));
+
+    const QTextBlock one = doc->findBlockByNumber(2);
+    const QTextBlock two = doc->findBlockByNumber(3);
+    const QTextBlock nested = doc->findBlockByNumber(4);
+    QVERIFY(one.textList());
+    QCOMPARE(one.textList(), two.textList());
+    QVERIFY(nested.textList());
+    QVERIFY(nested.textList() != one.textList());
+    QCOMPARE(one.textList()->format().indent(), 1);
+    QCOMPARE(nested.textList()->format().indent(), 2);
+
+    QCOMPARE(edit.toMarkdownText(), markdown);
+
+    // An escaped bracket does not end the text of a link
+    edit.setMarkdownText(QStringLiteral("[a\\](u) rest"));
+    QCOMPARE(edit.toPlainText(), QStringLiteral("[a](u) rest"));
+    QVERIFY(edit.links().isEmpty());
+    edit.setMarkdownText(QStringLiteral("[a\\]b](u) rest"));
+    QCOMPARE(edit.toPlainText(), QStringLiteral("a]b rest"));
+    QCOMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).text, QStringLiteral("a]b"));
+
+    // Neither do escapes and code spans reach beyond it
+    edit.setMarkdownText(QStringLiteral("[a\\\\](u) rest"));
+    QCOMPARE(edit.toPlainText(), QStringLiteral("a\\ rest"));
+    QCOMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).text, QStringLiteral("a\\"));
+    edit.setMarkdownText(QStringLiteral("[a `b](u) c` d"));
+    QCOMPARE(edit.toPlainText(), QStringLiteral("a `b c` d"));
+    QCOMPARE(edit.links().size(), 1);
+    QCOMPARE(edit.links().at(0).text, QStringLiteral("a `b"));
+    QCOMPARE(edit.links().at(0).url, QStringLiteral("u"));
+}
+
+void KRichTextEditTest::testSetTextOrHtml()
+{
+    KRichTextEdit edit;
+    QTest::keyClicks(&edit, QStringLiteral("typed"));
+    edit.selectAll();
+    QVERIFY(edit.document()->isUndoAvailable());
+
+    // The actions following these signals must see the new state
+    QSignalSpy textSpy(&edit, &QTextEdit::textChanged);
+    QSignalSpy undoSpy(&edit, &QTextEdit::undoAvailable);
+    QSignalSpy copySpy(&edit, &QTextEdit::copyAvailable);
+    QSignalSpy cursorSpy(&edit, &QTextEdit::cursorPositionChanged);
+    edit.setTextOrHtml(QStringLiteral("<p><b>rich</b> text</p>"));
+    QCOMPARE(edit.textMode(), KRichTextEdit::Rich);
+    QCOMPARE(edit.toPlainText(), QStringLiteral("rich text"));
+    QVERIFY(!edit.document()->isUndoAvailable());
+    QVERIFY(!textSpy.isEmpty());
+    QVERIFY(!cursorSpy.isEmpty());
+    QVERIFY(!undoSpy.isEmpty());
+    QCOMPARE(undoSpy.last().at(0).toBool(), false);
+    QVERIFY(!copySpy.isEmpty());
+    QCOMPARE(copySpy.last().at(0).toBool(), false);
+
+    edit.setTextOrHtml(QStringLiteral("plain text"));
+    QCOMPARE(edit.toPlainText(), QStringLiteral("plain text"));
+}
+
+void KRichTextEditTest::testCoalescedActionUpdates()
+{
+    KRichTextWidget widget;
+    const QList<QAction *> actions = widget.createActions();
+    QAction *boldAction = nullptr;
+    for (QAction *action : actions) {
+        if (action->objectName() == QLatin1String("format_text_bold")) {
+            boldAction = action;
+        }
+    }
+    QVERIFY(boldAction);
+    QVERIFY(!boldAction->isChecked());
+
+    widget.setActionStateUpdatesCoalesced(true);
+    QVERIFY(widget.actionStateUpdatesCoalesced());
+    widget.setTextBold(true);
+    QVERIFY(!boldAction->isChecked());
+    QTRY_VERIFY(boldAction->isChecked());
+
+    widget.setTextBold(false);
+    QVERIFY(boldAction->isChecked());
+    widget.setActionStateUpdatesCoalesced(false);
+    QVERIFY(!boldAction->isChecked());
+}
+
+void KRichTextEditTest::testFontActionOnDemand()
+{
+    const QString family = QFontDatabase().families().value(0);
+    if (family.isEmpty()) {
+        QSKIP("No fonts installed");
+    }
+
+    KRichTextWidget widget;
+    widget.setActionsCreatedOnDemand(true);
+    const QList<QAction *> actions = widget.createActions();
+    KSelectAction *fontAction = nullptr;
+    for (QAction *action : actions) {
+        if (action->objectName() == QLatin1String("format_font_family")) {
+            fontAction = qobject_cast<KSelectAction *>(action);
+        }
+    }
+    QVERIFY(fontAction);
+
+    // The fonts are not loaded yet, but the menu loading them can be opened
+    QVERIFY(fontAction->isEnabled());
+    QVERIFY(fontAction->items().isEmpty());
+    widget.setFontFamily(family);
+    QVERIFY(fontAction->currentText().isEmpty());
+
+    // The font set before is selected once they are loaded
+    widget.setActionsEnabled(false);
+    emit fontAction->menu()->aboutToShow();
+    QVERIFY(!fontAction->items().isEmpty());
+    QCOMPARE(fontAction->currentText(), family);
+    QVERIFY(!fontAction->isEnabled());
+    widget.setActionsEnabled(true);
+    QVERIFY(fontAction->isEnabled());
+
+    // And fonts set afterwards right away
+    const QString otherFamily = fontAction->items().constLast();
+    widget.setFontFamily(otherFamily);
+    QCOMPARE(fontAction->currentText(), otherFamily);
+
+    // Choosing a font sets it in the text
+    fontAction->action(family)->trigger();
+    QCOMPARE(widget.currentCharFormat().fontFamily(), family);
+}
+
+// Number of cursorPositionChanged() signals for pressing key at position in
+// edit, whose first two paragraphs are list items if inList is true
+static int cursorPositionChangedCount(QTextEdit &edit, bool inList, int position, Qt::Key key,
+                                      const QString &text = QString())
+{
+    edit.setPlainText(QStringLiteral("first\nsecond\nthird"));
+    if (inList) {
+        QTextCursor cursor(edit.document());
+        cursor.setPosition(edit.document()->findBlockByNumber(1).position(), QTextCursor::KeepAnchor);
+        cursor.createList(QTextListFormat::ListDisc);
+    }
+    QTextCursor cursor(edit.document());
+    cursor.setPosition(position);
+    edit.setTextCursor(cursor);
+
+    QSignalSpy spy(&edit, &QTextEdit::cursorPositionChanged);
+    QTest::keyClick(&edit, key, Qt::NoModifier);
+    if (!text.isEmpty()) {
+        QTest::keyClicks(&edit, text);
+    }
+    return spy.count();
+}
+
+void KRichTextEditTest::testKeyPressCursorPositionChanged()
+{
+    KRichTextEdit edit;
+    QTextEdit plain;
+
+    // Typing, also in lists, is announced by QTextEdit alone
+    QCOMPARE(cursorPositionChangedCount(edit, false, 2, Qt::Key_A, QStringLiteral("bc")),
+             cursorPositionChangedCount(plain, false, 2, Qt::Key_A, QStringLiteral("bc")));
+    QCOMPARE(cursorPositionChangedCount(edit, true, 2, Qt::Key_A, QStringLiteral("bc")),
+             cursorPositionChangedCount(plain, true, 2, Qt::Key_A, QStringLiteral("bc")));
+    QCOMPARE(cursorPositionChangedCount(edit, false, 2, Qt::Key_Right),
+             cursorPositionChangedCount(plain, false, 2, Qt::Key_Right));
+
+    // So is Return, which moves the cursor, outside of lists
+    QCOMPARE(cursorPositionChangedCount(edit, false, 2, Qt::Key_Return),
+             cursorPositionChangedCount(plain, false, 2, Qt::Key_Return));
+
+    // Return in a list may change the list
+    QCOMPARE(cursorPositionChangedCount(edit, true, 2, Qt::Key_Return),
+             cursorPositionChangedCount(plain, true, 2, Qt::Key_Return) + 1);
+    QCOMPARE(edit.document()->findBlockByNumber(1).textList(), edit.document()->firstBlock().textList());
+
+    // Merging paragraphs without moving the cursor changes the following ones
+    const int endOfFirst = QStringLiteral("first").length();
+    QCOMPARE(cursorPositionChangedCount(edit, false, endOfFirst, Qt::Key_Delete),
+             cursorPositionChangedCount(plain, false, endOfFirst, Qt::Key_Delete) + 1);
+    QCOMPARE(edit.document()->blockCount(), 2);
+
+    // Backspace at the start of a list item only changes the list
+    const int startOfSecond = endOfFirst + 1;
+    QVERIFY(cursorPositionChangedCount(edit, true, startOfSecond, Qt::Key_Backspace) > 0);
+    QCOMPARE(edit.textCursor().position(), startOfSecond);
+}
+
+void KRichTextEditTest::testNestedListIndent()
+{
+    KRichTextEdit edit;
+    edit.setPlainText(QStringLiteral("a\nb\nc\nd"));
+    edit.selectAll();
+    edit.setListStyle(-QTextListFormat::ListDisc);
+
+    QTextDocument *doc = edit.document();
+    QTextCursor cursor(doc->findBlockByNumber(1));
+    edit.setTextCursor(cursor);
+    edit.indentListMore();
+    cursor = QTextCursor(doc->findBlockByNumber(2));
+    edit.setTextCursor(cursor);
+    edit.indentListMore();
+
+    const QTextBlock a = doc->findBlockByNumber(0);
+    const QTextBlock b = doc->findBlockByNumber(1);
+    const QTextBlock c = doc->findBlockByNumber(2);
+    const QTextBlock d = doc->findBlockByNumber(3);
+    QVERIFY(a.textList());
+    QCOMPARE(a.textList(), d.textList());
+    QCOMPARE(b.textList(), c.textList());
+    QVERIFY(b.textList() != a.textList());
+    QCOMPARE(b.textList()->format().indent(), a.textList()->format().indent() + 1);
+
+    // Dedenting the last sublist item splits it from the sublist
+    edit.setTextCursor(QTextCursor(c));
+    edit.indentListLess();
+    QCOMPARE(c.textList(), a.textList());
+    QCOMPARE(b.textList()->count(), 1);
+}
+
+void KRichTextEditTest::testNestedListIndentSelection()
+{
+    KRichTextEdit edit;
+    edit.setPlainText(QStringLiteral("a\nb\nc\nd"));
+    edit.selectAll();
+    edit.setListStyle(-QTextListFormat::ListDisc);
+
+    QTextDocument *doc = edit.document();
+    const QTextBlock a = doc->findBlockByNumber(0);
+    const QTextBlock b = doc->findBlockByNumber(1);
+    const QTextBlock c = doc->findBlockByNumber(2);
+    const QTextBlock d = doc->findBlockByNumber(3);
+    const int undoSteps = doc->availableUndoSteps();
+
+    QTextCursor cursor(b);
+    cursor.setPosition(c.position() + 1, QTextCursor::KeepAnchor);
+    edit.setTextCursor(cursor);
+    edit.indentListMore();
+    QCOMPARE(doc->availableUndoSteps(), undoSteps + 1);
+    QCOMPARE(b.textList(), c.textList());
+    QCOMPARE(a.textList(), d.textList());
+    QCOMPARE(b.textList()->format().indent(), a.textList()->format().indent() + 1);
+
+    edit.setListStyle(-QTextListFormat::ListDecimal);
+    QCOMPARE(b.textList()->format().style(), QTextListFormat::ListDecimal);
+    QCOMPARE(a.textList()->format().style(), QTextListFormat::ListDisc);
+
+    edit.indentListLess();
+    QCOMPARE(b.textList(), a.textList());
+    QCOMPARE(c.textList(), a.textList());
+    QCOMPARE(d.textList(), a.textList());
+}
+
+void KRichTextEditTest::testPasteHtml()
+{
+    PasteTextWidget edit;
+    edit.setRichTextSupport(KRichTextWidget::SupportBold | KRichTextWidget::SupportHyperlinks | KRichTextWidget::FullListSupport);
+    edit.enableRichTextMode();
+    QTextDocument *doc = edit.document();
+    const int undoSteps = doc->availableUndoSteps();
+
+    QMimeData mimeData;
+    mimeData.setHtml(QStringLiteral(
+        "<html><head><style>p { color: red; }</style><title>Page</title></head><body>\n"
+        "<!--StartFragment--><h1>Title</h1>\n"
+        "<p style=\"color: #ff0000; font-family: 'Comic Sans MS'\">Some   <b>bold</b> and <i>italic</i>\n"
+        "text &amp; <a href=\"https://www.kde.org\">a link</a></p><img src=\"image.png\">\n"
+        "<ul><li>one<li>two</ul><table><tr><td>a<td>b</table>\n"
+        "<script>document.write('<p>script</p>');</script><!--EndFragment--></body></html>"));
+    edit.insertFromMimeData(&mimeData);
+
+    QCOMPARE(edit.toPlainText(), QStringLiteral("Title\nSome bold and italic text & a link\none\ntwo\na\tb"));
+    QCOMPARE(doc->availableUndoSteps(), undoSteps + 1);
+
+    // Headings are bold, but their size is not supported
+    QTextCursor cursor(doc->findBlockByNumber(0));
+    cursor.movePosition(QTextCursor::NextCharacter);
+    QCOMPARE(cursor.charFormat().fontWeight(), static_cast<int>(QFont::Bold));
+    QVERIFY(!cursor.charFormat().hasProperty(QTextFormat::FontSizeAdjustment));
+
+    // Only the supported formatting of the paragraph is kept
+    const QTextBlock paragraph = doc->findBlockByNumber(1);
+    cursor.setPosition(paragraph.position() + 2);
+    QVERIFY(!cursor.charFormat().hasProperty(QTextFormat::ForegroundBrush));
+    QVERIFY(!cursor.charFormat().hasProperty(QTextFormat::FontFamily));
+    cursor.setPosition(paragraph.position() + 7);
+    QCOMPARE(cursor.charFormat().fontWeight(), static_cast<int>(QFont::Bold));
+    cursor.setPosition(paragraph.position() + 16);
+    QVERIFY(!cursor.charFormat().fontItalic());
+    const QVector<KRichTextEdit::Link> links = edit.links();
+    QCOMPARE(links.size(), 1);
+    QCOMPARE(links.at(0).url, QStringLiteral("https://www.kde.org"));
+    QCOMPARE(links.at(0).text, QStringLiteral("a link"));
+
+    QVERIFY(doc->findBlockByNumber(2).textList());
+    QCOMPARE(doc->findBlockByNumber(3).textList(), doc->findBlockByNumber(2).textList());
+    QVERIFY(!doc->findBlockByNumber(4).textList());
+    QVERIFY(!edit.toHtml().contains(QLatin1String("image.png")));
+
+    // Without support for lists, the items are plain paragraphs
+    edit.clear();
+    edit.setRichTextSupport(KRichTextWidget::SupportBold);
+    mimeData.setHtml(QStringLiteral("<ol><li>one</li><li>two</li></ol>"));
+    edit.insertFromMimeData(&mimeData);
+    QCOMPARE(edit.toPlainText(), QStringLiteral("one\ntwo"));
+    QVERIFY(!doc->findBlockByNumber(0).textList());
+
+    // Preformatted whitespace is kept, line breaks ending a block are not shown
+    edit.clear();
+    mimeData.setHtml(QStringLiteral(
+        "<p style=\"white-space: pre-wrap\">a\tb  c</p><p>d<br></p>"
+        "<p style=\"-qt-paragraph-type:empty\"><br /></p><p>e<br><br>f</p>"));
+    edit.insertFromMimeData(&mimeData);
+    QCOMPARE(edit.toPlainText(), QStringLiteral("a\tb  c\nd\n\ne\n\nf"));
+    QCOMPARE(doc->blockCount(), 4);
+}
+
+void KRichTextEditTest::testPasteHtmlRoundTrip()
+{
+    PasteTextWidget edit;
+    edit.enableRichTextMode();
+    const QString text = QStringLiteral("Tab\tand  double  spaces\n\n\nAfter blank lines\n    indented\n");
+    edit.textCursor().insertText(text);
+
+    edit.selectAll();
+    QScopedPointer<QMimeData> mimeData(edit.createMimeDataFromSelection());
+    QVERIFY(mimeData->hasHtml());
+    edit.clear();
+    edit.insertFromMimeData(mimeData.data());
+    QCOMPARE(edit.toPlainText(), text);
+    QCOMPARE(edit.document()->blockCount(), 6);
+}
+
+void KRichTextEditTest::testPasteHtmlLinks_data()
+{
+    QTest::addColumn<QString>("href");
+    QTest::addColumn<QString>("url");
+
+    QTest::newRow("https") << QStringLiteral("https://www.kde.org") << QStringLiteral("https://www.kde.org");
+    QTest::newRow("upper case") << QStringLiteral("HTTP://www.kde.org") << QStringLiteral("HTTP://www.kde.org");
+    QTest::newRow("ftp") << QStringLiteral("ftp://ftp.kde.org") << QStringLiteral("ftp://ftp.kde.org");
+    QTest::newRow("mailto") << QStringLiteral("mailto:kde@kde.org") << QStringLiteral("mailto:kde@kde.org");
+    QTest::newRow("file") << QStringLiteral("file:///tmp/a.txt") << QStringLiteral("file:///tmp/a.txt");
+    QTest::newRow("relative") << QStringLiteral("../index.html") << QStringLiteral("../index.html");
+    QTest::newRow("relative with colon") << QStringLiteral("/wiki/Help:Contents") << QStringLiteral("/wiki/Help:Contents");
+    QTest::newRow("fragment") << QStringLiteral("#top") << QStringLiteral("#top");
+    QTest::newRow("surrounding whitespace") << QStringLiteral("  https://www.kde.org\n") << QStringLiteral("https://www.kde.org");
+    QTest::newRow("javascript") << QStringLiteral("javascript:alert(1)") << QString();
+    QTest::newRow("upper case javascript") << QStringLiteral("JavaScript:alert(1)") << QString();
+    QTest::newRow("leading whitespace") << QStringLiteral(" \t javascript:alert(1)") << QString();
+    QTest::newRow("leading control character") << QStringLiteral("\x01javascript:alert(1)") << QString();
+    QTest::newRow("tab") << QStringLiteral("java\tscript:alert(1)") << QString();
+    QTest::newRow("newline") << QStringLiteral("java\nscript:alert(1)") << QString();
+    QTest::newRow("carriage return") << QStringLiteral("javascript\r\n:alert(1)") << QString();
+    QTest::newRow("entity") << QStringLiteral("java&#9;script:alert(1)") << QString();
+    QTest::newRow("space") << QStringLiteral("java script:alert(1)") << QString();
+    QTest::newRow("zero width space") << QStringLiteral("java\u200bscript:alert(1)") << QString();
+    QTest::newRow("vbscript") << QStringLiteral("vbscript:msgbox(1)") << QString();
+    QTest::newRow("data") << QStringLiteral("data:text/html;base64,PHNjcmlwdD4=") << QString();
+}
+
+void KRichTextEditTest::testPasteHtmlLinks()
+{
+    QFETCH(QString, href);
+    QFETCH(QString, url);
+
+    PasteTextWidget edit;
+    edit.setRichTextSupport(KRichTextWidget::SupportHyperlinks);
+    edit.enableRichTextMode();
+    QMimeData mimeData;
+    mimeData.setHtml(QStringLiteral("<a href=\"%1\">a link</a>").arg(href));
+    edit.insertFromMimeData(&mimeData);
+
+    // Unsafe links are pasted as plain text
+    QCOMPARE(edit.toPlainText(), QStringLiteral("a link"));
+    const QVector<KRichTextEdit::Link> links = edit.links();
+    if (url.isEmpty()) {
+        QVERIFY(links.isEmpty());
+    } else {
+        QCOMPARE(links.size(), 1);
+        QCOMPARE(links.at(0).url, url);
+    }
+}
@@ -30,9 +30,25 @@ private Q_SLOTS:
     void testLinebreaks();
     void testUpdateLinkAdd();
     void testUpdateLinkRemove();
+    void testSelectLinkText();
+    void testLinks();
+    void testAutoLinking();
+    void testChunkedPasteAutoLinking();
+    void testSwitchToPlainText();
     void testHTMLLineBreaks();
     void testHTMLOrderedLists();
     void testHTMLUnorderedLists();
+    void testMarkdown();
+    void testSetTextOrHtml();
+    void testCoalescedActionUpdates();
+    void testFontActionOnDemand();
+    void testKeyPressCursorPositionChanged();
+    void testNestedListIndent();
+    void testNestedListIndentSelection();
+    void testPasteHtml();
+    void testPasteHtmlLinks_data();
+    void testPasteHtmlLinks();
+    void testPasteHtmlRoundTrip();
 };
 
 #endif
@@ -19,17 +19,153 @@
     Boston, MA 02110-1301, USA.
 */
 
+#include <QAbstractTextDocumentLayout>
 #include <QClipboard>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QMimeData>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QScrollBar>
+#include <QSignalSpy>
+#include <QStandardPaths>
 #include <QTest>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QThread>
+#include <QTimer>
 
 #include <ktextedit.h>
+#include <kconfiggroup.h>
+#include <kconfigwatcher.h>
+#include <ksharedconfig.h>
+#include <kstandardshortcut.h>
+#include <sonnet/dialog.h>
+
+// Gives access to the mime data created for copies and to pasting it
+class MimeDataTextEdit : public KTextEdit
+{
+public:
+    using KTextEdit::createMimeDataFromSelection;
+    using KTextEdit::insertFromMimeData;
+};
+
+// Does not check paragraphs starting with '#'
+class SkipCommentsTextEdit : public KTextEdit
+{
+public:
+    bool shouldBlockBeSpellChecked(const QString &block) const override
+    {
+        return !block.startsWith(QLatin1Char('#'));
+    }
+};
+
+// The words marked as misspelled in block
+static QStringList misspelledWords(const QTextBlock &block)
+{
+    QStringList words;
+    const QVector<QTextLayout::FormatRange> formats = block.layout()->formats();
+    for (const QTextLayout::FormatRange &range : formats) {
+        if (range.format.underlineStyle() == QTextCharFormat::SpellCheckUnderline) {
+            words.append(block.text().mid(range.start, range.length));
+        }
+    }
+    return words;
+}
+
+// Creates the default highlighter for English. Returns false if there is
+// no English dictionary, spell checking cannot be tested then.
+static bool createEnglishHighlighter(KTextEdit &edit)
+{
+    edit.createHighlighter();
+    edit.setSpellCheckingLanguage(QStringLiteral("en_US"));
+    Sonnet::Highlighter *highlighter = edit.highlighter();
+    return highlighter->spellCheckerFound() && highlighter->isWordMisspelled(QStringLiteral("xqzvbnmw"))
+           && !highlighter->isWordMisspelled(QStringLiteral("house"));
+}
+
+// Opens the context menu at position and clicks the action with the
+// text actionText. Returns false if the menu has no such action.
+static bool triggerContextMenuAction(KTextEdit &edit, int position, const QString &actionText)
+{
+    QTextCursor cursor(edit.document());
+    cursor.setPosition(position);
+    const QPoint pos = edit.cursorRect(cursor).center();
+    bool triggered = false;
+    // Fires in the event loop of the menu
+    QTimer timer;
+    timer.setSingleShot(true);
+    QObject::connect(&timer, &QTimer::timeout, [&triggered, &actionText]() {
+        QMenu *menu = qobject_cast<QMenu *>(QApplication::activePopupWidget());
+        if (!menu) {
+            return;
+        }
+        const QList<QAction *> actions = menu->actions();
+        for (QAction *action : actions) {
+            if (action->text().remove(QLatin1Char('&')) == actionText) {
+                QTest::mouseClick(menu, Qt::LeftButton, Qt::NoModifier, menu->actionGeometry(action).center());
+                triggered = true;
+                return;
+            }
+        }
+        menu->close();
+    });
+    timer.start(0);
+    QContextMenuEvent event(QContextMenuEvent::Mouse, pos, edit.viewport()->mapToGlobal(pos));
+    QApplication::sendEvent(edit.viewport(), &event);
+    return triggered;
+}
+
+// Announces a change of the shortcuts in the configuration, as it would be
+// received from KConfig's change notifications
+static void announceShortcutChange()
+{
+    const KConfigWatcher::Ptr watcher = KConfigWatcher::create(KSharedConfig::openConfig());
+    emit watcher->configChanged(KConfigGroup(KSharedConfig::openConfig(), "Shortcuts"), {"End"});
+}
+
+// Presses the first key of the standard shortcut id
+static void pressStandardShortcut(QWidget *widget, KStandardShortcut::StandardShortcut id)
+{
+    const QKeySequence shortcut = KStandardShortcut::shortcut(id).value(0);
+    QTest::keyClick(widget, Qt::Key(shortcut[0] & ~Qt::KeyboardModifierMask),
+                    Qt::KeyboardModifiers(shortcut[0] & Qt::KeyboardModifierMask));
+}
+
+static Sonnet::Dialog *visibleSpellCheckDialog()
+{
+    const QWidgetList widgets = QApplication::topLevelWidgets();
+    for (QWidget *widget : widgets) {
+        Sonnet::Dialog *dialog = qobject_cast<Sonnet::Dialog *>(widget);
+        if (dialog && dialog->isVisible()) {
+            return dialog;
+        }
+    }
+    return nullptr;
+}
 
 class KTextEdit_UnitTest : public QObject
 {
     Q_OBJECT
 
 private Q_SLOTS:
+    void initTestCase();
     void testPaste();
+    void testAdoptDocument();
+    void testLargePlainText();
+    void testLargePlainTextScrolling();
+    void testStandardShortcuts();
+    void testPageUpDown();
+    void testCopyMimeData();
+    void testChunkedPaste();
+    void testApplyTextDiff();
+    void testSnapshot();
+    void testViewportSpellChecking();
+    void testThreadedSpellChecking();
+    void testSpellCheckCache();
+    void testSpellCheckDialog();
+    void testSpellCheckSkipRegions();
     // These tests are probably invalid due to using invalid html.
 //     void testImportWithHorizontalTraversal();
 //     void testImportWithVerticalTraversal();
@@ -37,6 +173,12 @@ private Q_SLOTS:
 
 };
 
+void KTextEdit_UnitTest::initTestCase()
+{
+    // Keeps the shortcuts saved by the tests out of the user's configuration
+    QStandardPaths::setTestModeEnabled(true);
+}
+
 void KTextEdit_UnitTest::testPaste()
 {
     const QString origText = QApplication::clipboard()->text();
@@ -50,6 +192,745 @@ void KTextEdit_UnitTest::testPaste()
     QApplication::clipboard()->setText(origText);
 }
 
+void KTextEdit_UnitTest::testAdoptDocument()
+{
+    KTextEdit w;
+    w.document()->setIndentWidth(17);
+    // The document of QTextEdit itself is deleted by QTextEdit
+    QPointer<QTextDocument> original(w.document());
+
+    QTextDocument *first = new QTextDocument;
+    first->setPlainText(QStringLiteral("First"));
+    w.adoptDocument(first);
+    QVERIFY(original.isNull());
+    QCOMPARE(w.document(), first);
+    QCOMPARE(first->parent(), &w);
+    QCOMPARE(first->indentWidth(), qreal(17));
+    QCOMPARE(w.toPlainText(), QStringLiteral("First"));
+
+    QPointer<QTextDocument> guard(first);
+    QTextDocument *second = new QTextDocument;
+    second->setHtml(QStringLiteral("<p>Second</p>"));
+    w.adoptDocument(second);
+    QCOMPARE(w.document(), second);
+    QCOMPARE(w.toPlainText(), QStringLiteral("Second"));
+    QVERIFY(guard.isNull());
+}
+
+void KTextEdit_UnitTest::testLargePlainText()
+{
+    QByteArray text;
+    for (int i = 0; i < 10000; ++i) {
+        text += "line " + QByteArray::number(i) + '\n';
+    }
+
+    KTextEdit w;
+    w.resize(400, 300);
+    w.setLargePlainText(text);
+    QVERIFY(w.isLargeDocumentMode());
+    QVERIFY(w.isReadOnly());
+    QVERIFY(w.document()->blockCount() < 10000);
+    QCOMPARE(w.document()->firstBlock().text(), QStringLiteral("line 0"));
+
+    w.setLargePlainText(QByteArray());
+    QVERIFY(!w.isLargeDocumentMode());
+    QVERIFY(!w.isReadOnly());
+    QVERIFY(w.document()->isEmpty());
+}
+
+void KTextEdit_UnitTest::testLargePlainTextScrolling()
+{
+    // CR LF line breaks, with a CR or a paragraph separator here and there
+    QByteArray text;
+    for (int i = 0; i < 10000; ++i) {
+        if (i > 0) {
+            text += i % 7 == 0 ? QByteArray("\r") : i % 11 == 0 ? QByteArray("\xe2\x80\xa9") : QByteArray("\r\n");
+        }
+        text += "line " + QByteArray::number(i);
+    }
+
+    KTextEdit w;
+    w.resize(400, 300);
+    w.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&w));
+    w.setLargePlainText(text);
+
+    // The scroll bar of the whole text is the one next to the viewport
+    QScrollBar *scrollBar = nullptr;
+    const QList<QScrollBar *> scrollBars = w.findChildren<QScrollBar *>();
+    for (QScrollBar *candidate : scrollBars) {
+        if (candidate->orientation() == Qt::Vertical && candidate != w.verticalScrollBar()) {
+            scrollBar = candidate;
+        }
+    }
+    QVERIFY(scrollBar);
+    QVERIFY(scrollBar->maximum() > 9900);
+    QVERIFY(scrollBar->maximum() < 10000);
+
+    const int lines[] = {0, 1, 500, 4321, 7777, 9000};
+    for (const int line : lines) {
+        scrollBar->setValue(line);
+        const QTextBlock top = w.cursorForPosition(QPoint(0, 0)).block();
+        QCOMPARE(top.text(), QStringLiteral("line %1").arg(line));
+        // Every loaded line is a line of the text, without line breaks
+        const QTextDocument *doc = w.document();
+        const int first = doc->firstBlock().text().midRef(5).toInt();
+        for (QTextBlock block = doc->firstBlock(); block.isValid(); block = block.next()) {
+            QCOMPARE(block.text(), QStringLiteral("line %1").arg(first + block.blockNumber()));
+        }
+    }
+    scrollBar->setValue(scrollBar->maximum());
+    QCOMPARE(w.document()->lastBlock().text(), QStringLiteral("line 9999"));
+
+    // Scrolling the text edit itself moves the window as well
+    scrollBar->setValue(5000);
+    for (int i = 0; i < 100; ++i) {
+        w.verticalScrollBar()->triggerAction(QAbstractSlider::SliderPageStepAdd);
+    }
+    const QTextBlock top = w.cursorForPosition(QPoint(0, 0)).block();
+    const int topLine = top.text().midRef(5).toInt();
+    QVERIFY(topLine > 5000);
+    QCOMPARE(scrollBar->value(), topLine);
+
+    // Setting the text by other means leaves large document mode
+    w.setPlainText(QStringLiteral("other text"));
+    QVERIFY(!w.isLargeDocumentMode());
+    QVERIFY(!w.isReadOnly());
+    QCOMPARE(w.toPlainText(), QStringLiteral("other text"));
+}
+
+void KTextEdit_UnitTest::testStandardShortcuts()
+{
+    KTextEdit w;
+    w.setPlainText(QStringLiteral("first line\nsecond line"));
+    w.moveCursor(QTextCursor::Start);
+
+    const QKeySequence end = KStandardShortcut::end().value(0);
+    QVERIFY(!end.isEmpty());
+    QTest::keyClick(&w, Qt::Key(end[0] & ~Qt::KeyboardModifierMask),
+                    Qt::KeyboardModifiers(end[0] & Qt::KeyboardModifierMask));
+    QCOMPARE(w.textCursor().position(), w.document()->characterCount() - 1);
+
+    const QKeySequence begin = KStandardShortcut::begin().value(0);
+    QVERIFY(!begin.isEmpty());
+    QTest::keyClick(&w, Qt::Key(begin[0] & ~Qt::KeyboardModifierMask),
+                    Qt::KeyboardModifiers(begin[0] & Qt::KeyboardModifierMask));
+    QCOMPARE(w.textCursor().position(), 0);
+
+    // Changed shortcuts apply once the change is announced
+    const QList<QKeySequence> ends = KStandardShortcut::end();
+    KStandardShortcut::saveShortcut(KStandardShortcut::End, {QKeySequence(Qt::CTRL + Qt::Key_F12)});
+    announceShortcutChange();
+    QTest::keyClick(&w, Qt::Key_F12, Qt::ControlModifier);
+    QCOMPARE(w.textCursor().position(), w.document()->characterCount() - 1);
+    KStandardShortcut::saveShortcut(KStandardShortcut::End, ends);
+    announceShortcutChange();
+    w.moveCursor(QTextCursor::Start);
+    QTest::keyClick(&w, Qt::Key_F12, Qt::ControlModifier);
+    QCOMPARE(w.textCursor().position(), 0);
+}
+
+void KTextEdit_UnitTest::testPageUpDown()
+{
+    QStringList lines;
+    for (int i = 0; i < 200; ++i) {
+        lines.append(QStringLiteral("line %1").arg(i));
+    }
+    KTextEdit w;
+    w.setPlainText(lines.join(QLatin1Char('\n')));
+    w.resize(400, 300);
+    w.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&w));
+    w.moveCursor(QTextCursor::Start);
+
+    const QTextDocument *doc = w.document();
+    const qreal lineHeight = doc->documentLayout()->blockBoundingRect(doc->firstBlock()).height();
+    const int linesPerPage = qRound(w.viewport()->height() / lineHeight);
+    QVERIFY(linesPerPage > 1);
+
+    // One page down lands one page of lines further, in the same column
+    w.moveCursor(QTextCursor::EndOfLine);
+    pressStandardShortcut(&w, KStandardShortcut::Next);
+    int blockNumber = w.textCursor().blockNumber();
+    QVERIFY2(qAbs(blockNumber - linesPerPage) <= 1, qPrintable(QString::number(blockNumber)));
+    QVERIFY(w.textCursor().positionInBlock() > 0);
+    QVERIFY(w.verticalScrollBar()->value() > 0);
+
+    // And one page up back again
+    pressStandardShortcut(&w, KStandardShortcut::Prior);
+    QCOMPARE(w.textCursor().blockNumber(), 0);
+    QVERIFY(w.verticalScrollBar()->value() <= doc->documentMargin());
+    w.verticalScrollBar()->setValue(0);
+
+    // At the top, only to the first line
+    QTextCursor cursor(doc->findBlockByNumber(2));
+    w.setTextCursor(cursor);
+    pressStandardShortcut(&w, KStandardShortcut::Prior);
+    QCOMPARE(w.textCursor().blockNumber(), 0);
+    QCOMPARE(w.verticalScrollBar()->value(), 0);
+
+    // Less than a page before the end, to the last line
+    w.moveCursor(QTextCursor::End);
+    cursor = QTextCursor(doc->findBlockByNumber(doc->blockCount() - 3));
+    w.setTextCursor(cursor);
+    const int scrollValue = w.verticalScrollBar()->value();
+    pressStandardShortcut(&w, KStandardShortcut::Next);
+    QCOMPARE(w.textCursor().blockNumber(), doc->blockCount() - 1);
+    QCOMPARE(w.verticalScrollBar()->value(), scrollValue);
+    pressStandardShortcut(&w, KStandardShortcut::Next);
+    QCOMPARE(w.textCursor().blockNumber(), doc->blockCount() - 1);
+
+    // Text shorter than a page
+    w.setPlainText(QStringLiteral("first line\nsecond line\nthird line"));
+    w.moveCursor(QTextCursor::Start);
+    pressStandardShortcut(&w, KStandardShortcut::Next);
+    QCOMPARE(w.textCursor().blockNumber(), 2);
+    pressStandardShortcut(&w, KStandardShortcut::Prior);
+    QCOMPARE(w.textCursor().blockNumber(), 0);
+}
+
+void KTextEdit_UnitTest::testCopyMimeData()
+{
+    MimeDataTextEdit w;
+    w.setAcceptRichText(false);
+    w.setPlainText(QStringLiteral("first line\nsecond\u00a0line"));
+    w.selectAll();
+
+    QScopedPointer<QMimeData> plain(w.createMimeDataFromSelection());
+    QCOMPARE(plain->formats(), QStringList{QStringLiteral("text/plain")});
+    QVERIFY(!plain->hasHtml());
+
+    // The selection is frozen when the mime data is created
+    w.setPlainText(QStringLiteral("changed"));
+    QCOMPARE(plain->text(), QStringLiteral("first line\nsecond line"));
+    QCOMPARE(plain->text(), QStringLiteral("first line\nsecond line"));
+
+    w.setAcceptRichText(true);
+    w.setHtml(QStringLiteral("<p><b>bold</b> text</p>"));
+    w.selectAll();
+    QScopedPointer<QMimeData> rich(w.createMimeDataFromSelection());
+    QVERIFY(rich->hasText());
+    QVERIFY(rich->hasHtml());
+    w.clear();
+    QCOMPARE(rich->text(), QStringLiteral("bold text"));
+    QVERIFY(rich->html().contains(QLatin1String("font-weight:600")));
+    QCOMPARE(rich->text(), QStringLiteral("bold text"));
+
+    // Once another owner takes the clipboard over, the data is released
+    const QString origText = QApplication::clipboard()->text();
+    w.setPlainText(QStringLiteral("copied"));
+    w.selectAll();
+    QMimeData *copied = w.createMimeDataFromSelection();
+    QPointer<QMimeData> guard(copied);
+    QApplication::clipboard()->setMimeData(copied);
+    QCOMPARE(QApplication::clipboard()->text(), QStringLiteral("copied"));
+    QApplication::clipboard()->setText(origText);
+    QVERIFY(guard.isNull() || guard->formats().isEmpty());
+}
+
+void KTextEdit_UnitTest::testChunkedPaste()
+{
+    QString pasted;
+    for (int i = 0; i < 20000; ++i) {
+        pasted += QStringLiteral("Pasted line %1\n").arg(i);
+    }
+    QMimeData mimeData;
+    mimeData.setText(pasted);
+
+    MimeDataTextEdit w;
+    w.setPlainText(QStringLiteral("before selected after"));
+    QTextCursor cursor = w.textCursor();
+    cursor.setPosition(7);
+    cursor.setPosition(15, QTextCursor::KeepAnchor);
+    w.setTextCursor(cursor);
+    const int undoSteps = w.document()->availableUndoSteps();
+
+    // Below the threshold, the text is inserted at once
+    w.setChunkedPasteThreshold(pasted.size());
+    QCOMPARE(w.chunkedPasteThreshold(), pasted.size());
+    w.insertFromMimeData(&mimeData);
+    QVERIFY(!w.isChunkedPasteActive());
+    QCOMPARE(w.toPlainText(), QStringLiteral("before ") + pasted + QStringLiteral(" after"));
+    w.undo();
+    QCOMPARE(w.toPlainText(), QStringLiteral("before selected after"));
+
+    w.setTextCursor(cursor);
+    w.setChunkedPasteThreshold(1000);
+    QSignalSpy progressSpy(&w, &KTextEdit::chunkedPasteProgress);
+    QSignalSpy finishedSpy(&w, &KTextEdit::chunkedPasteFinished);
+    w.insertFromMimeData(&mimeData);
+    QVERIFY(w.isChunkedPasteActive());
+    QVERIFY(w.isReadOnly());
+    QCOMPARE(finishedSpy.count(), 0);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toBool(), false);
+    QVERIFY(progressSpy.count() > 1);
+    QCOMPARE(progressSpy.last().at(0).toInt(), pasted.size());
+    QCOMPARE(progressSpy.last().at(1).toInt(), pasted.size());
+    QVERIFY(!w.isReadOnly());
+    QCOMPARE(w.toPlainText(), QStringLiteral("before ") + pasted + QStringLiteral(" after"));
+    QCOMPARE(w.textCursor().position(), 7 + pasted.size());
+
+    // The whole paste is a single undo step
+    QCOMPARE(w.document()->availableUndoSteps(), undoSteps + 1);
+    w.undo();
+    QCOMPARE(w.toPlainText(), QStringLiteral("before selected after"));
+
+    // Canceling removes the text inserted so far
+    w.setTextCursor(cursor);
+    finishedSpy.clear();
+    w.insertFromMimeData(&mimeData);
+    QVERIFY(w.isChunkedPasteActive());
+    w.cancelChunkedPaste();
+    QVERIFY(!w.isChunkedPasteActive());
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toBool(), true);
+    QCOMPARE(w.toPlainText(), QStringLiteral("before selected after"));
+    QVERIFY(!w.isReadOnly());
+
+    // Formatting changes leave the paste alone, other changes cancel it
+    w.setTextCursor(cursor);
+    finishedSpy.clear();
+    w.insertFromMimeData(&mimeData);
+    QTextCursor outside(w.document());
+    outside.setPosition(6, QTextCursor::KeepAnchor);
+    QTextCharFormat bold;
+    bold.setFontWeight(QFont::Bold);
+    outside.mergeCharFormat(bold);
+    QVERIFY(w.isChunkedPasteActive());
+    outside.setPosition(0);
+    outside.insertText(QStringLiteral("Now "));
+    QVERIFY(!w.isChunkedPasteActive());
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toBool(), true);
+    QTRY_COMPARE(w.toPlainText(), QStringLiteral("Now before selected after"));
+    QVERIFY(!w.isReadOnly());
+
+    // Each chunk is spell checked when it is inserted
+    const QStringList misspelled = {QStringLiteral("xqzvbnmw")};
+    pasted.clear();
+    for (int i = 0; i < 10000; ++i) {
+        pasted += QStringLiteral("The house has a xqzvbnmw\n");
+    }
+    mimeData.setText(pasted);
+    w.clear();
+    if (!createEnglishHighlighter(w)) {
+        QSKIP("No English dictionary available");
+    }
+    w.insertFromMimeData(&mimeData);
+    QVERIFY(w.isChunkedPasteActive());
+    QCOMPARE(misspelledWords(w.document()->firstBlock()), misspelled);
+    QVERIFY(w.document()->blockCount() < 10000);
+    QTRY_VERIFY(!w.isChunkedPasteActive());
+    QCOMPARE(misspelledWords(w.document()->findBlockByNumber(9999)), misspelled);
+}
+
+void KTextEdit_UnitTest::testApplyTextDiff()
+{
+    KTextEdit w;
+    w.setPlainText(QStringLiteral("one\ntwo\nthree\nfour\nfive"));
+    w.document()->findBlockByNumber(2).setUserState(42);
+    const int undoSteps = w.document()->availableUndoSteps();
+
+    // Only the changed lines are touched
+    w.applyTextDiff(QStringLiteral("zero\none\n2\nthree\nfive\nsix"));
+    QCOMPARE(w.toPlainText(), QStringLiteral("zero\none\n2\nthree\nfive\nsix"));
+    QCOMPARE(w.document()->findBlockByNumber(3).userState(), 42);
+    QCOMPARE(w.document()->availableUndoSteps(), undoSteps + 1);
+
+    w.applyTextDiff(w.toPlainText());
+    QCOMPARE(w.document()->availableUndoSteps(), undoSteps + 1);
+
+    w.undo();
+    QCOMPARE(w.toPlainText(), QStringLiteral("one\ntwo\nthree\nfour\nfive"));
+
+    // Other line breaks match the blocks as well
+    w.document()->findBlockByNumber(2).setUserState(42);
+    w.applyTextDiff(QStringLiteral("one\r\ntwo\r\nthree\r\r\nfour"));
+    QCOMPARE(w.toPlainText(), QStringLiteral("one\ntwo\nthree\n\nfour"));
+    QCOMPARE(w.document()->findBlockByNumber(2).userState(), 42);
+
+    w.applyTextDiff(QString());
+    QCOMPARE(w.toPlainText(), QString());
+
+    // Large document mode replaces the whole text
+    w.setLargePlainText(QByteArrayLiteral("one\ntwo"));
+    QVERIFY(w.isLargeDocumentMode());
+    w.applyTextDiff(QStringLiteral("one\nthree"));
+    QVERIFY(w.isLargeDocumentMode());
+    QCOMPARE(w.toPlainText(), QStringLiteral("one\nthree"));
+    w.setLargePlainText(QByteArray());
+
+    // Random texts of few different lines, so that there are many matches
+    QRandomGenerator random(4711);
+    const QStringList lines = {QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c"), QString()};
+    const auto randomText = [&random, &lines]() {
+        QStringList text;
+        const int count = random.bounded(1, 15);
+        for (int i = 0; i < count; ++i) {
+            text.append(lines.at(random.bounded(lines.size())));
+        }
+        return text.join(QLatin1Char('\n'));
+    };
+    for (int i = 0; i < 500; ++i) {
+        const QString oldText = randomText();
+        const QString newText = randomText();
+        w.setPlainText(oldText);
+        w.applyTextDiff(newText);
+        QCOMPARE(w.toPlainText(), newText);
+    }
+}
+
+void KTextEdit_UnitTest::testSnapshot()
+{
+    QVERIFY(KTextEditSnapshot().isNull());
+
+    KTextEdit w;
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines.append(QStringLiteral("Line %1").arg(i));
+    }
+    const QString text = lines.join(QLatin1Char('\n'));
+    w.setPlainText(text);
+
+    const KTextEditSnapshot first = w.snapshot();
+    QVERIFY(!first.isNull());
+    QCOMPARE(first.revision(), w.document()->revision());
+    QCOMPARE(first.blockCount(), 1000);
+    QCOMPARE(first.blockText(0), QStringLiteral("Line 0"));
+    QCOMPARE(first.blockText(999), QStringLiteral("Line 999"));
+    QCOMPARE(first.blockText(1000), QString());
+    QCOMPARE(first.length(), text.size());
+    QCOMPARE(first.toPlainText(), text);
+
+    // Later edits only show up in later snapshots
+    QTextCursor cursor(w.document()->findBlockByNumber(300));
+    cursor.insertText(QStringLiteral("Inserted\n"));
+    cursor = QTextCursor(w.document()->findBlockByNumber(700));
+    cursor.select(QTextCursor::BlockUnderCursor);
+    cursor.removeSelectedText();
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(QStringLiteral("\nLast"));
+
+    const KTextEditSnapshot second = w.snapshot();
+    QCOMPARE(first.toPlainText(), text);
+    QCOMPARE(second.toPlainText(), w.toPlainText());
+    QCOMPARE(second.blockCount(), w.document()->blockCount());
+    QCOMPARE(second.length(), w.toPlainText().size());
+    QCOMPARE(second.blockText(300), QStringLiteral("Inserted"));
+    QCOMPARE(second.blockText(second.blockCount() - 1), QStringLiteral("Last"));
+    QVERIFY(second.revision() > first.revision());
+
+    // Random edits between snapshots
+    QRandomGenerator random(4711);
+    for (int i = 0; i < 200; ++i) {
+        const int edits = random.bounded(1, 4);
+        for (int j = 0; j < edits; ++j) {
+            cursor.setPosition(random.bounded(w.document()->characterCount()));
+            const int length = random.bounded(30);
+            cursor.setPosition(qMin(cursor.position() + length, w.document()->characterCount() - 1), QTextCursor::KeepAnchor);
+            cursor.insertText(random.bounded(2) ? QStringLiteral("x\ny") : QString());
+        }
+        const KTextEditSnapshot snapshot = w.snapshot();
+        QCOMPARE(snapshot.toPlainText(), w.toPlainText());
+        QCOMPARE(snapshot.blockCount(), w.document()->blockCount());
+        const int blockNumber = random.bounded(snapshot.blockCount());
+        QCOMPARE(snapshot.blockText(blockNumber), w.document()->findBlockByNumber(blockNumber).text());
+    }
+
+    // A snapshot may be read while the text edit changes
+    const QString secondText = second.toPlainText();
+    QString threadText;
+    QScopedPointer<QThread> thread(QThread::create([second, &threadText]() {
+        threadText = second.toPlainText();
+    }));
+    thread->start();
+    w.clear();
+    QVERIFY(thread->wait());
+    QCOMPARE(threadText, secondText);
+    QCOMPARE(w.snapshot().toPlainText(), QString());
+    QCOMPARE(w.snapshot().blockCount(), 1);
+
+    // A new document gets new snapshots
+    QTextDocument *document = new QTextDocument(QStringLiteral("Other\ndocument"), &w);
+    w.setDocument(document);
+    QCOMPARE(w.snapshot().toPlainText(), QStringLiteral("Other\ndocument"));
+}
+
+void KTextEdit_UnitTest::testViewportSpellChecking()
+{
+    const QStringList misspelled = {QStringLiteral("xqzvbnmw")};
+    QStringList lines;
+    for (int i = 0; i < 2000; ++i) {
+        lines.append(QStringLiteral("The house has a xqzvbnmw"));
+    }
+    KTextEdit w;
+    w.setPlainText(lines.join(QLatin1Char('\n')));
+    w.resize(400, 300);
+    w.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&w));
+    w.setSpellCheckingRestrictedToViewport(true);
+    QVERIFY(w.isSpellCheckingRestrictedToViewport());
+    if (!createEnglishHighlighter(w)) {
+        QSKIP("No English dictionary available");
+    }
+
+    // Only the blocks around the visible ones are checked
+    const QTextDocument *doc = w.document();
+    QCOMPARE(misspelledWords(doc->firstBlock()), misspelled);
+    QVERIFY(misspelledWords(doc->findBlockByNumber(1000)).isEmpty());
+    QVERIFY(misspelledWords(doc->lastBlock()).isEmpty());
+
+    // The others once they are scrolled into view
+    w.verticalScrollBar()->setValue(w.verticalScrollBar()->maximum());
+    QTRY_COMPARE(misspelledWords(doc->lastBlock()), misspelled);
+    QVERIFY(misspelledWords(doc->findBlockByNumber(1000)).isEmpty());
+
+    // Edits outside of the viewport are checked when scrolled to as well
+    QTextCursor cursor(doc->findBlockByNumber(10));
+    cursor.insertText(QStringLiteral("qqxxzzvv "));
+    QVERIFY(misspelledWords(doc->findBlockByNumber(10)).isEmpty());
+    w.verticalScrollBar()->setValue(0);
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(10)),
+                 QStringList({QStringLiteral("qqxxzzvv"), QStringLiteral("xqzvbnmw")}));
+
+    // Without the restriction, all blocks are checked
+    w.setSpellCheckingRestrictedToViewport(false);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(1000)), misspelled);
+}
+
+void KTextEdit_UnitTest::testThreadedSpellChecking()
+{
+    const QStringList misspelled = {QStringLiteral("xqzvbnmw")};
+    QStringList lines;
+    for (int i = 0; i < 50; ++i) {
+        lines.append(QStringLiteral("The house has a xqzvbnmw"));
+    }
+    KTextEdit w;
+    w.setPlainText(lines.join(QLatin1Char('\n')));
+    w.resize(400, 300);
+    w.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&w));
+    w.setThreadedSpellCheckingEnabled(true);
+    QVERIFY(w.isThreadedSpellCheckingEnabled());
+    if (!createEnglishHighlighter(w)) {
+        QSKIP("No English dictionary available");
+    }
+
+    // The results of the worker are applied later
+    const QTextDocument *doc = w.document();
+    QTRY_COMPARE(misspelledWords(doc->lastBlock()), misspelled);
+    QCOMPARE(misspelledWords(doc->firstBlock()), misspelled);
+
+    // Only the edited block is checked again. The result for its first
+    // edit is outdated when it arrives and must not be applied.
+    const KTextEdit::SpellCheckCacheStatistics before = KTextEdit::spellCheckCacheStatistics();
+    QTextCursor cursor(doc->findBlockByNumber(5));
+    cursor.insertText(QStringLiteral("qqxxzzvv "));
+    cursor.setPosition(doc->findBlockByNumber(5).position());
+    cursor.insertText(QStringLiteral("big "));
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(5)), QStringList({QStringLiteral("qqxxzzvv"), QStringLiteral("xqzvbnmw")}));
+    const KTextEdit::SpellCheckCacheStatistics after = KTextEdit::spellCheckCacheStatistics();
+    // At most the words of both versions of the block
+    QVERIFY(after.hits + after.misses - before.hits - before.misses <= 13);
+    QCOMPARE(misspelledWords(doc->firstBlock()), misspelled);
+
+    // While the edited block is checked again, its underlines stay
+    const QStringList edited = {QStringLiteral("qqxxzzvv"), QStringLiteral("xqzvbnmw")};
+    cursor = QTextCursor(doc->findBlockByNumber(5));
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    cursor.insertText(QStringLiteral(" house"));
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(5)), edited);
+    QTest::qWait(100);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(5)), edited);
+
+    // A word ignored from the context menu is not marked anymore, also not
+    // by the worker, which has a speller of its own
+    QVERIFY(triggerContextMenuAction(w, doc->firstBlock().position() + 18, QStringLiteral("Ignore")));
+    QTRY_VERIFY(misspelledWords(doc->lastBlock()).isEmpty());
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(5)), QStringList{QStringLiteral("qqxxzzvv")});
+    cursor.setPosition(doc->findBlockByNumber(10).position());
+    cursor.insertText(QStringLiteral("zzqqkkvv xqzvbnmw "));
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(10)), QStringList{QStringLiteral("zzqqkkvv")});
+
+    w.setThreadedSpellCheckingEnabled(false);
+    QVERIFY(!w.isThreadedSpellCheckingEnabled());
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(10)), QStringList{QStringLiteral("zzqqkkvv")});
+}
+
+void KTextEdit_UnitTest::testSpellCheckCache()
+{
+    const QString text = QStringLiteral("The house has a xqzvbnmw\nThe garden has a xqzvbnmw");
+    const QStringList misspelled = {QStringLiteral("xqzvbnmw")};
+    KTextEdit first;
+    first.setPlainText(text);
+    first.resize(400, 300);
+    first.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&first));
+    first.setThreadedSpellCheckingEnabled(true);
+    KTextEdit::clearSpellCheckCache();
+    QCOMPARE(KTextEdit::spellCheckCacheStatistics().words, 0);
+    if (!createEnglishHighlighter(first)) {
+        QSKIP("No English dictionary available");
+    }
+    QTRY_COMPARE(misspelledWords(first.document()->lastBlock()), misspelled);
+    const KTextEdit::SpellCheckCacheStatistics checked = KTextEdit::spellCheckCacheStatistics();
+    QVERIFY(checked.words > 0);
+
+    // Another text edit finds all the words in the cache
+    KTextEdit second;
+    second.setPlainText(text);
+    second.resize(400, 300);
+    second.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&second));
+    second.setThreadedSpellCheckingEnabled(true);
+    QVERIFY(createEnglishHighlighter(second));
+    QTRY_COMPARE(misspelledWords(second.document()->lastBlock()), misspelled);
+    KTextEdit::SpellCheckCacheStatistics statistics = KTextEdit::spellCheckCacheStatistics();
+    QCOMPARE(statistics.misses, checked.misses);
+    QVERIFY(statistics.hits > checked.hits);
+    QCOMPARE(statistics.words, checked.words);
+
+    // A word ignored in one text edit leaves the cache, but stays
+    // misspelled in the others
+    QVERIFY(triggerContextMenuAction(first, 18, QStringLiteral("Ignore")));
+    QCOMPARE(KTextEdit::spellCheckCacheStatistics().words, checked.words - 1);
+    QTRY_VERIFY(misspelledWords(first.document()->lastBlock()).isEmpty());
+    QTextCursor cursor(second.document());
+    cursor.insertText(QStringLiteral("zzqqkkvv "));
+    QTRY_COMPARE(misspelledWords(second.document()->firstBlock()),
+                 QStringList({QStringLiteral("zzqqkkvv"), QStringLiteral("xqzvbnmw")}));
+    QCOMPARE(misspelledWords(second.document()->lastBlock()), misspelled);
+
+    KTextEdit::clearSpellCheckCache();
+    statistics = KTextEdit::spellCheckCacheStatistics();
+    QCOMPARE(statistics.words, 0);
+}
+
+void KTextEdit_UnitTest::testSpellCheckDialog()
+{
+    // Long enough for several chunks of the dialog
+    QStringList lines;
+    for (int i = 0; i < 300; ++i) {
+        lines.append(QStringLiteral("A line with xqzvbnmw"));
+    }
+    const QString text = lines.join(QLatin1Char('\n'));
+    const QString misspelled = QStringLiteral("xqzvbnmw");
+    const QString corrected = QStringLiteral("A line with word");
+    KTextEdit w;
+    w.setPlainText(text);
+    const int undoSteps = w.document()->availableUndoSteps();
+
+    // The corrections of all chunks are a single undo step
+    w.checkSpelling();
+    QPointer<Sonnet::Dialog> dialog = visibleSpellCheckDialog();
+    QVERIFY(dialog);
+    QVERIFY(w.isReadOnly());
+    QVERIFY(dialog->buffer().size() < text.size());
+    emit dialog->replace(misspelled, dialog->buffer().indexOf(misspelled), QStringLiteral("word"));
+    QCOMPARE(w.document()->firstBlock().text(), corrected);
+    emit dialog->done(dialog->buffer());
+    QVERIFY(dialog->buffer().startsWith(QStringLiteral("A line with xqzvbnmw")));
+    emit dialog->replace(misspelled, dialog->buffer().indexOf(misspelled), QStringLiteral("word"));
+    QCOMPARE(w.toPlainText().count(corrected), 2);
+    QVERIFY(w.document()->findBlockByNumber(1).text() != corrected);
+
+    // Typing is not possible while the dialog is open
+    QTest::keyClicks(&w, QStringLiteral("typed"));
+    QCOMPARE(w.toPlainText().count(QStringLiteral("typed")), 0);
+
+    // Calling it again only activates the open dialog
+    w.checkSpelling();
+    QCOMPARE(visibleSpellCheckDialog(), dialog.data());
+
+    while (w.isReadOnly()) {
+        emit dialog->done(dialog->buffer());
+    }
+    QCOMPARE(w.document()->availableUndoSteps(), undoSteps + 1);
+    w.undo();
+    QCOMPARE(w.toPlainText(), text);
+    dialog->close();
+    QTRY_VERIFY(dialog.isNull());
+
+    // Canceling undoes the corrections of all chunks, and nothing else
+    w.checkSpelling();
+    dialog = visibleSpellCheckDialog();
+    QVERIFY(dialog);
+    emit dialog->replace(misspelled, dialog->buffer().indexOf(misspelled), QStringLiteral("word"));
+    emit dialog->done(dialog->buffer());
+    emit dialog->replace(misspelled, dialog->buffer().indexOf(misspelled), QStringLiteral("word"));
+    QCOMPARE(w.toPlainText().count(corrected), 2);
+    emit dialog->cancel();
+    QCOMPARE(w.toPlainText(), text);
+    QCOMPARE(w.document()->availableUndoSteps(), undoSteps);
+    QVERIFY(!w.isReadOnly());
+    dialog->close();
+    QTRY_VERIFY(dialog.isNull());
+
+    // Closing the dialog ends the check as well
+    w.checkSpelling();
+    dialog = visibleSpellCheckDialog();
+    QVERIFY(dialog);
+    QVERIFY(w.isReadOnly());
+    dialog->close();
+    QTRY_VERIFY(dialog.isNull());
+    QVERIFY(!w.isReadOnly());
+}
+
+void KTextEdit_UnitTest::testSpellCheckSkipRegions()
+{
+    const QStringList misspelled = {QStringLiteral("xqzvbnmw")};
+    const QStringList lines = {
+        QStringLiteral("The house has a xqzvbnmw"),
+        QStringLiteral("> The house has a xqzvbnmw"),
+        QStringLiteral("  > The house has a xqzvbnmw"),
+        QStringLiteral("The house a > xqzvbnmw"),
+        QStringLiteral("See https://xqzvbnmw.org/xqzvbnmw or www.xqzvbnmw.org and xqzvbnmw"),
+        QStringLiteral("Call `xqzvbnmw` and `xqzvbnmw xqzvbnmw` with xqzvbnmw"),
+        QStringLiteral("An open `xqzvbnmw quote"),
+        QStringLiteral("# The house has a xqzvbnmw"),
+    };
+    SkipCommentsTextEdit w;
+    w.setPlainText(lines.join(QLatin1Char('\n')));
+    w.setSpellCheckSkipRegions(KTextEdit::SkipQuotedLines | KTextEdit::SkipUrls | KTextEdit::SkipInlineCode);
+    QCOMPARE(w.spellCheckSkipRegions(),
+             KTextEdit::SkipQuotedLines | KTextEdit::SkipUrls | KTextEdit::SkipInlineCode);
+    if (!createEnglishHighlighter(w)) {
+        QSKIP("No English dictionary available");
+    }
+
+    const QTextDocument *doc = w.document();
+    QTRY_COMPARE(misspelledWords(doc->firstBlock()), misspelled);
+    // Quoted, also when indented, but only at the start
+    QVERIFY(misspelledWords(doc->findBlockByNumber(1)).isEmpty());
+    QVERIFY(misspelledWords(doc->findBlockByNumber(2)).isEmpty());
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(3)), misspelled);
+    // URLs
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(4)), misspelled);
+    // Inline code, an unmatched backtick starts none
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(5)), misspelled);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(6)), misspelled);
+    // shouldBlockBeSpellChecked()
+    QVERIFY(misspelledWords(doc->findBlockByNumber(7)).isEmpty());
+
+    // Edited paragraphs are classified again
+    QTextCursor cursor(doc->findBlockByNumber(1));
+    cursor.deleteChar();
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(1)), misspelled);
+    cursor.insertText(QStringLiteral(">"));
+    QTRY_VERIFY(misspelledWords(doc->findBlockByNumber(1)).isEmpty());
+    cursor = QTextCursor(doc->findBlockByNumber(7));
+    cursor.deleteChar();
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(7)), misspelled);
+
+    // And all of them when the regions change
+    w.setSpellCheckSkipRegions(KTextEdit::SkipUrls);
+    QTRY_COMPARE(misspelledWords(doc->findBlockByNumber(1)), misspelled);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(2)), misspelled);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(4)), misspelled);
+    QCOMPARE(misspelledWords(doc->findBlockByNumber(5)).size(), 4);
+}
+
 // void KTextEdit_UnitTest::testImportWithVerticalTraversal()
 // {
 //     QTextEdit *te = new QTextEdit();
@@ -0,0 +1,243 @@
+/* This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include <QMimeData>
+#include <QTest>
+#include <QTextBlock>
+#include <QTextDocument>
+
+#include <krichtextwidget.h>
+#include <ktextedit.h>
+
+// Gives access to the default highlighter without focusing the text edit
+class BenchmarkTextEdit : public KTextEdit
+{
+public:
+    using KTextEdit::createHighlighter;
+};
+
+// Gives access to the paste handling without going through the clipboard
+class BenchmarkTextWidget : public KRichTextWidget
+{
+public:
+    using KRichTextWidget::insertFromMimeData;
+};
+
+class KTextEditBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkHighlight_data();
+    void benchmarkHighlight();
+    void benchmarkPageDown();
+    void benchmarkPageUp();
+    void benchmarkTyping();
+    void benchmarkCreateActions_data();
+    void benchmarkCreateActions();
+    void benchmarkPasteHtml();
+    void benchmarkApplyTextDiff();
+    void benchmarkSnapshot();
+
+private:
+    QString m_mixedText;
+    QString m_longText;
+    QString m_webPage;
+};
+
+void KTextEditBenchmark::initTestCase()
+{
+    // About 1 MB of paragraphs in different languages, with quotes, URLs,
+    // inline code and some misspelled words
+    const QStringList paragraphs = {
+        QStringLiteral("The quick brown fox jumps over the lazy dog while the commitee discusses the recieved proposal."),
+        QStringLiteral("Der schnelle braune Fuchs springt über den faulen Hund, während die Komission den Vorschlag prüft."),
+        QStringLiteral("Le renard brun rapide saute par-dessus le chien paresseux pendant que le comité examine la proposition."),
+        QStringLiteral("> Quoted text from the previous mail, which is usually not worth checking again at all."),
+        QStringLiteral("See https://www.kde.org/announcements/ and call `KTextEdit::setSpellCheckSkipRegions()` for details."),
+    };
+    while (m_mixedText.size() < 1024 * 1024) {
+        for (const QString &paragraph : paragraphs) {
+            m_mixedText += paragraph;
+            m_mixedText += QLatin1Char('\n');
+        }
+    }
+
+    // 100000 short lines, for paging
+    m_longText.reserve(100000 * 12);
+    for (int i = 0; i < 100000; ++i) {
+        m_longText += QStringLiteral("Line %1\n").arg(i);
+    }
+
+    // About 3 MB of HTML like copied from a web page, with style sheets,
+    // scripts, styled paragraphs, images and tables
+    m_webPage = QStringLiteral("<html><head><style>body { font-family: sans-serif; }</style>"
+                               "<script>var tracking = '<p>ignored</p>';</script></head><body>");
+    while (m_webPage.size() < 3 * 1024 * 1024) {
+        m_webPage += QStringLiteral(
+            "<div class=\"article\" style=\"margin: 4px\"><h2 style=\"color: #202020\">Heading</h2>"
+            "<p style=\"font-family: Georgia, serif; font-size: 15px; color: rgb(20, 20, 20)\">The <b>quick</b> "
+            "<span style=\"font-weight: 700; background-color: #ffffcc\">brown</span> fox jumps over the "
+            "<a href=\"https://www.kde.org/\" style=\"color: blue\">lazy dog</a>&nbsp;&amp; friends.</p>"
+            "<img src=\"https://www.kde.org/logo.png\" width=\"64\" height=\"64\">"
+            "<ul><li>First <i>item</i></li><li>Second item</li></ul>"
+            "<table border=\"1\"><tr><td>Cell</td><td>Other cell</td></tr></table></div>\n");
+    }
+    m_webPage += QStringLiteral("</body></html>");
+}
+
+void KTextEditBenchmark::benchmarkHighlight_data()
+{
+    QTest::addColumn<int>("skipRegions");
+
+    QTest::newRow("sonnet") << int(KTextEdit::SkipNothing);
+    QTest::newRow("skipRegions") << int(KTextEdit::SkipQuotedLines | KTextEdit::SkipUrls | KTextEdit::SkipInlineCode);
+}
+
+void KTextEditBenchmark::benchmarkHighlight()
+{
+    QFETCH(int, skipRegions);
+
+    BenchmarkTextEdit edit;
+    edit.setPlainText(m_mixedText);
+    edit.setSpellCheckSkipRegions(KTextEdit::SpellCheckSkipRegions(skipRegions));
+    edit.createHighlighter();
+    if (!edit.highlighter()->spellCheckerFound()) {
+        QSKIP("No spell checking backend available");
+    }
+
+    QBENCHMARK {
+        edit.highlighter()->rehighlight();
+    }
+}
+
+void KTextEditBenchmark::benchmarkPageDown()
+{
+    KTextEdit edit;
+    edit.setPlainText(m_longText);
+    edit.resize(400, 300);
+    edit.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&edit));
+    edit.moveCursor(QTextCursor::Start);
+
+    QBENCHMARK {
+        QTest::keyClick(&edit, Qt::Key_PageDown);
+    }
+    QVERIFY(edit.textCursor().blockNumber() > 0);
+}
+
+void KTextEditBenchmark::benchmarkPageUp()
+{
+    KTextEdit edit;
+    edit.setPlainText(m_longText);
+    edit.resize(400, 300);
+    edit.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&edit));
+    edit.moveCursor(QTextCursor::End);
+
+    QBENCHMARK {
+        QTest::keyClick(&edit, Qt::Key_PageUp);
+    }
+    QVERIFY(edit.textCursor().blockNumber() < edit.document()->blockCount() - 1);
+}
+
+void KTextEditBenchmark::benchmarkTyping()
+{
+    // All actions are created, so each key press also pays for their updates
+    KRichTextWidget edit;
+    edit.setRichTextSupport(KRichTextWidget::FullSupport);
+    edit.createActions();
+    edit.setPlainText(m_mixedText.left(64 * 1024));
+    edit.moveCursor(QTextCursor::End);
+
+    QBENCHMARK {
+        QTest::keyClicks(&edit, QStringLiteral("typing "));
+    }
+}
+
+void KTextEditBenchmark::benchmarkCreateActions_data()
+{
+    QTest::addColumn<bool>("onDemand");
+
+    QTest::newRow("eager") << false;
+    QTest::newRow("onDemand") << true;
+}
+
+void KTextEditBenchmark::benchmarkCreateActions()
+{
+    QFETCH(bool, onDemand);
+
+    QBENCHMARK {
+        KRichTextWidget edit;
+        edit.setActionsCreatedOnDemand(onDemand);
+        edit.createActions();
+    }
+}
+
+void KTextEditBenchmark::benchmarkPasteHtml()
+{
+    QMimeData mimeData;
+    mimeData.setHtml(m_webPage);
+
+    QBENCHMARK {
+        BenchmarkTextWidget edit;
+        edit.setRichTextSupport(KRichTextWidget::SupportBold | KRichTextWidget::SupportItalic
+                                | KRichTextWidget::SupportHyperlinks | KRichTextWidget::FullListSupport);
+        edit.enableRichTextMode();
+        edit.insertFromMimeData(&mimeData);
+    }
+}
+
+void KTextEditBenchmark::benchmarkApplyTextDiff()
+{
+    // Every revision changes, inserts and removes a line in the middle
+    QStringList lines = m_longText.split(QLatin1Char('\n'));
+    KTextEdit edit;
+    edit.setPlainText(m_longText);
+    int revision = 0;
+
+    QBENCHMARK {
+        ++revision;
+        const int line = 50000 + revision % 100;
+        lines[line] = QStringLiteral("Changed line %1").arg(revision);
+        lines.insert(line + 10, QStringLiteral("Inserted line %1").arg(revision));
+        lines.removeAt(line + 20);
+        edit.applyTextDiff(lines.join(QLatin1Char('\n')));
+    }
+    QCOMPARE(edit.toPlainText(), lines.join(QLatin1Char('\n')));
+}
+
+void KTextEditBenchmark::benchmarkSnapshot()
+{
+    // A snapshot after every typed character, like an autosave would take
+    KTextEdit edit;
+    edit.setPlainText(m_longText);
+    QTextCursor cursor(edit.document()->findBlockByNumber(50000));
+    KTextEditSnapshot snapshot = edit.snapshot();
+
+    QBENCHMARK {
+        cursor.insertText(QStringLiteral("x"));
+        snapshot = edit.snapshot();
+    }
+    QCOMPARE(snapshot.blockText(50000), cursor.block().text());
+}
+
+QTEST_MAIN(KTextEditBenchmark)
+
+#include "ktexteditbenchmark.moc"
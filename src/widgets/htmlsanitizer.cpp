@@ -0,0 +1,871 @@
+/**
+ * HTML sanitizer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "htmlsanitizer_p.h"
+
+#include <kcolorscheme.h>
+
+#include <QColor>
+#include <QSet>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextList>
+
+//@cond PRIVATE
+
+static bool isHtmlSpace(QChar c)
+{
+    return c == QLatin1Char(' ') || c == QLatin1Char('\t') || c == QLatin1Char('\n')
+           || c == QLatin1Char('\r') || c == QLatin1Char('\f');
+}
+
+static bool isBlockElement(const QString &name)
+{
+    static const QSet<QString> elements = {
+        QStringLiteral("p"), QStringLiteral("div"), QStringLiteral("h1"), QStringLiteral("h2"),
+        QStringLiteral("h3"), QStringLiteral("h4"), QStringLiteral("h5"), QStringLiteral("h6"),
+        QStringLiteral("ul"), QStringLiteral("ol"), QStringLiteral("li"), QStringLiteral("dl"),
+        QStringLiteral("dt"), QStringLiteral("dd"), QStringLiteral("blockquote"), QStringLiteral("pre"),
+        QStringLiteral("table"), QStringLiteral("tr"), QStringLiteral("caption"), QStringLiteral("address"),
+        QStringLiteral("article"), QStringLiteral("aside"), QStringLiteral("section"), QStringLiteral("header"),
+        QStringLiteral("footer"), QStringLiteral("nav"), QStringLiteral("main"), QStringLiteral("figure"),
+        QStringLiteral("figcaption"), QStringLiteral("form"), QStringLiteral("fieldset"), QStringLiteral("center"),
+        QStringLiteral("details"), QStringLiteral("summary"),
+    };
+    return elements.contains(name);
+}
+
+static bool isVoidElement(const QString &name)
+{
+    static const QSet<QString> elements = {
+        QStringLiteral("br"), QStringLiteral("hr"), QStringLiteral("img"), QStringLiteral("meta"),
+        QStringLiteral("link"), QStringLiteral("input"), QStringLiteral("area"), QStringLiteral("base"),
+        QStringLiteral("col"), QStringLiteral("embed"), QStringLiteral("param"), QStringLiteral("source"),
+        QStringLiteral("track"), QStringLiteral("wbr"),
+    };
+    return elements.contains(name);
+}
+
+// Elements whose content is never shown as text
+static bool isSkippedElement(const QString &name)
+{
+    static const QSet<QString> elements = {
+        QStringLiteral("script"), QStringLiteral("style"), QStringLiteral("title"), QStringLiteral("template"),
+        QStringLiteral("noscript"), QStringLiteral("iframe"), QStringLiteral("object"), QStringLiteral("svg"),
+        QStringLiteral("math"), QStringLiteral("select"), QStringLiteral("textarea"), QStringLiteral("canvas"),
+        QStringLiteral("audio"), QStringLiteral("video"),
+    };
+    return elements.contains(name);
+}
+
+// Elements an implicitly closed element may not be closed across
+static bool isContainerElement(const QString &name)
+{
+    return name == QLatin1String("ul") || name == QLatin1String("ol") || name == QLatin1String("dl")
+           || name == QLatin1String("table") || name == QLatin1String("blockquote") || name == QLatin1String("div");
+}
+
+static uint namedEntity(const QStringRef &name)
+{
+    static const struct {
+        const char *name;
+        ushort code;
+    } entities[] = {
+        { "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' },
+        { "nbsp", 0x00a0 }, { "copy", 0x00a9 }, { "reg", 0x00ae }, { "trade", 0x2122 },
+        { "shy", 0x00ad }, { "ndash", 0x2013 }, { "mdash", 0x2014 }, { "lsquo", 0x2018 },
+        { "rsquo", 0x2019 }, { "ldquo", 0x201c }, { "rdquo", 0x201d }, { "laquo", 0x00ab },
+        { "raquo", 0x00bb }, { "hellip", 0x2026 }, { "bull", 0x2022 }, { "middot", 0x00b7 },
+        { "euro", 0x20ac }, { "pound", 0x00a3 }, { "yen", 0x00a5 }, { "cent", 0x00a2 },
+        { "sect", 0x00a7 }, { "deg", 0x00b0 }, { "times", 0x00d7 }, { "divide", 0x00f7 },
+        { "auml", 0x00e4 }, { "ouml", 0x00f6 }, { "uuml", 0x00fc }, { "Auml", 0x00c4 },
+        { "Ouml", 0x00d6 }, { "Uuml", 0x00dc }, { "szlig", 0x00df }, { "eacute", 0x00e9 },
+        { "egrave", 0x00e8 }, { "agrave", 0x00e0 }, { "ccedil", 0x00e7 }, { "zwnj", 0x200c },
+        { "zwj", 0x200d }, { "lrm", 0x200e }, { "rlm", 0x200f },
+    };
+    for (const auto &entity : entities) {
+        if (name == QLatin1String(entity.name)) {
+            return entity.code;
+        }
+    }
+    return 0;
+}
+
+static QString decodeEntities(const QStringRef &text)
+{
+    if (!text.contains(QLatin1Char('&'))) {
+        return text.toString();
+    }
+    QString result;
+    result.reserve(text.size());
+    int pos = 0;
+    while (pos < text.size()) {
+        const QChar c = text.at(pos);
+        const int end = c == QLatin1Char('&') ? text.indexOf(QLatin1Char(';'), pos + 1) : -1;
+        if (end == -1 || end - pos > 10) {
+            result += c;
+            ++pos;
+            continue;
+        }
+        const QStringRef entity = text.mid(pos + 1, end - pos - 1);
+        uint code = 0;
+        if (entity.startsWith(QLatin1Char('#'))) {
+            bool ok = false;
+            if (entity.startsWith(QLatin1String("#x"), Qt::CaseInsensitive)) {
+                code = entity.mid(2).toUInt(&ok, 16);
+            } else {
+                code = entity.mid(1).toUInt(&ok, 10);
+            }
+            if (!ok) {
+                code = 0;
+            }
+        } else {
+            code = namedEntity(entity);
+        }
+        if (code == 0 || code > 0x10ffff) {
+            result += c;
+            ++pos;
+            continue;
+        }
+        if (QChar::requiresSurrogates(code)) {
+            result += QChar(QChar::highSurrogate(code));
+            result += QChar(QChar::lowSurrogate(code));
+        } else {
+            result += QChar(code);
+        }
+        pos = end + 1;
+    }
+    return result;
+}
+
+static QColor parseColor(const QString &value)
+{
+    const QString color = value.trimmed();
+    if (color.startsWith(QLatin1String("rgb"), Qt::CaseInsensitive)) {
+        const int open = color.indexOf(QLatin1Char('('));
+        const int close = color.indexOf(QLatin1Char(')'), open);
+        if (open == -1 || close == -1) {
+            return QColor();
+        }
+        const QVector<QStringRef> components = color.midRef(open + 1, close - open - 1).split(QLatin1Char(','));
+        if (components.size() < 3) {
+            return QColor();
+        }
+        return QColor(components.at(0).trimmed().toInt(), components.at(1).trimmed().toInt(),
+                      components.at(2).trimmed().toInt());
+    }
+    if (color.compare(QLatin1String("transparent"), Qt::CaseInsensitive) == 0) {
+        return QColor();
+    }
+    return QColor(color);
+}
+
+static Qt::Alignment parseAlignment(const QString &value)
+{
+    const QString alignment = value.trimmed().toLower();
+    if (alignment == QLatin1String("left")) {
+        return Qt::AlignLeft;
+    } else if (alignment == QLatin1String("right")) {
+        return Qt::AlignRight;
+    } else if (alignment == QLatin1String("center")) {
+        return Qt::AlignHCenter;
+    } else if (alignment == QLatin1String("justify")) {
+        return Qt::AlignJustify;
+    }
+    return Qt::Alignment();
+}
+
+static Qt::LayoutDirection parseDirection(const QString &value)
+{
+    const QString direction = value.trimmed().toLower();
+    if (direction == QLatin1String("rtl")) {
+        return Qt::RightToLeft;
+    } else if (direction == QLatin1String("ltr")) {
+        return Qt::LeftToRight;
+    }
+    return Qt::LayoutDirectionAuto;
+}
+
+// Returns the first family of a font family list
+static QString firstFontFamily(const QString &families)
+{
+    QString family = families.section(QLatin1Char(','), 0, 0).trimmed();
+    if (family.size() > 1 && (family.startsWith(QLatin1Char('"')) || family.startsWith(QLatin1Char('\'')))) {
+        family = family.mid(1, family.size() - 2);
+    }
+    return family;
+}
+
+// Returns the link target href with whitespace and control characters
+// removed, or an empty string if it does not use one of the allowed schemes.
+// Browsers ignore them as well, so "java\tscript:" would be run as script.
+static QString safeHref(const QString &href)
+{
+    QString url;
+    url.reserve(href.size());
+    for (const QChar c : href) {
+        if (c.category() != QChar::Other_Control && c.category() != QChar::Other_Format) {
+            url.append(c);
+        }
+    }
+    url = url.trimmed();
+
+    // Relative URLs have no scheme before the first path, query or fragment
+    const int colon = url.indexOf(QLatin1Char(':'));
+    if (colon == -1) {
+        return url;
+    }
+    QString scheme;
+    for (int i = 0; i < colon; ++i) {
+        const QChar c = url.at(i);
+        if (c == QLatin1Char('/') || c == QLatin1Char('?') || c == QLatin1Char('#')) {
+            return url;
+        }
+        if (!c.isSpace()) {
+            scheme.append(c.toLower());
+        }
+    }
+
+    static const char *const allowedSchemes[] = {"http", "https", "ftp", "mailto", "file"};
+    for (const char *allowed : allowedSchemes) {
+        if (scheme == QLatin1String(allowed)) {
+            return url;
+        }
+    }
+    return QString();
+}
+
+HtmlSanitizer::HtmlSanitizer(KRichTextWidget::RichTextSupport support)
+    : m_support(support)
+    , m_cursor(nullptr)
+    , m_pendingBlock(false)
+    , m_pendingListItem(false)
+    , m_atBlockStart(false)
+    , m_ownsBlock(false)
+    , m_lastWasSpace(false)
+    , m_qtRichText(false)
+    , m_pendingLineBreaks(0)
+{
+}
+
+void HtmlSanitizer::insert(const QString &html, QTextCursor &cursor)
+{
+    m_cursor = &cursor;
+    m_elements.clear();
+    m_pendingBlock = false;
+    m_pendingListItem = false;
+    // Block elements at the start continue the current block instead of
+    // splitting it, and only an empty block takes their formatting
+    m_atBlockStart = true;
+    m_ownsBlock = cursor.block().length() == 1;
+    m_lastWasSpace = false;
+    m_qtRichText = false;
+    m_pendingLineBreaks = 0;
+
+    cursor.beginEditBlock();
+    if (cursor.hasSelection()) {
+        cursor.removeSelectedText();
+    }
+    const int length = html.size();
+    int pos = 0;
+    while (pos < length) {
+        const int tagStart = html.indexOf(QLatin1Char('<'), pos);
+        const int textEnd = tagStart == -1 ? length : tagStart;
+        if (textEnd > pos) {
+            appendText(decodeEntities(html.midRef(pos, textEnd - pos)));
+        }
+        if (tagStart == -1) {
+            break;
+        }
+        pos = parseTag(html, tagStart);
+    }
+    flushLineBreaks(m_pendingBlock);
+    cursor.endEditBlock();
+
+    m_elements.clear();
+    m_cursor = nullptr;
+}
+
+// Parses the tag starting at start and returns the position after it
+int HtmlSanitizer::parseTag(const QString &html, int start)
+{
+    const int length = html.size();
+    int pos = start + 1;
+
+    if (html.midRef(pos, 3) == QLatin1String("!--")) {
+        const int end = html.indexOf(QLatin1String("-->"), pos + 3);
+        return end == -1 ? length : end + 3;
+    }
+    if (pos < length && (html.at(pos) == QLatin1Char('!') || html.at(pos) == QLatin1Char('?'))) {
+        const int end = html.indexOf(QLatin1Char('>'), pos);
+        return end == -1 ? length : end + 1;
+    }
+
+    const bool closing = pos < length && html.at(pos) == QLatin1Char('/');
+    if (closing) {
+        ++pos;
+    }
+    const int nameStart = pos;
+    while (pos < length && (html.at(pos).isLetterOrNumber() || html.at(pos) == QLatin1Char('-')
+                            || html.at(pos) == QLatin1Char(':'))) {
+        ++pos;
+    }
+    if (pos == nameStart) {
+        // Not a tag, just a '<' in the text
+        appendText(QStringLiteral("<"));
+        return start + 1;
+    }
+    const QString name = html.mid(nameStart, pos - nameStart).toLower();
+
+    QHash<QString, QString> attributes;
+    bool selfClosing = false;
+    while (pos < length) {
+        const QChar c = html.at(pos);
+        if (c == QLatin1Char('>')) {
+            ++pos;
+            break;
+        }
+        if (c == QLatin1Char('/')) {
+            selfClosing = true;
+            ++pos;
+            continue;
+        }
+        if (isHtmlSpace(c)) {
+            ++pos;
+            continue;
+        }
+        selfClosing = false;
+
+        const int attributeStart = pos;
+        while (pos < length && !isHtmlSpace(html.at(pos)) && html.at(pos) != QLatin1Char('=')
+               && html.at(pos) != QLatin1Char('>') && html.at(pos) != QLatin1Char('/')) {
+            ++pos;
+        }
+        if (pos == attributeStart) {
+            ++pos;
+            continue;
+        }
+        const QString attribute = html.mid(attributeStart, pos - attributeStart).toLower();
+        while (pos < length && isHtmlSpace(html.at(pos))) {
+            ++pos;
+        }
+        QStringRef value;
+        if (pos < length && html.at(pos) == QLatin1Char('=')) {
+            ++pos;
+            while (pos < length && isHtmlSpace(html.at(pos))) {
+                ++pos;
+            }
+            if (pos < length && (html.at(pos) == QLatin1Char('"') || html.at(pos) == QLatin1Char('\''))) {
+                const int end = html.indexOf(html.at(pos), pos + 1);
+                const int valueEnd = end == -1 ? length : end;
+                value = html.midRef(pos + 1, valueEnd - pos - 1);
+                pos = end == -1 ? length : end + 1;
+            } else {
+                const int valueStart = pos;
+                while (pos < length && !isHtmlSpace(html.at(pos)) && html.at(pos) != QLatin1Char('>')) {
+                    ++pos;
+                }
+                value = html.midRef(valueStart, pos - valueStart);
+            }
+        }
+        if (!closing) {
+            attributes.insert(attribute, decodeEntities(value));
+        }
+    }
+
+    if (closing) {
+        endElement(name);
+        return pos;
+    }
+    if (isSkippedElement(name)) {
+        if (selfClosing) {
+            return pos;
+        }
+        // Jump over the content, which might contain anything but its end tag
+        const int end = html.indexOf(QLatin1String("</") + name, pos, Qt::CaseInsensitive);
+        if (end == -1) {
+            return length;
+        }
+        const int close = html.indexOf(QLatin1Char('>'), end);
+        return close == -1 ? length : close + 1;
+    }
+    startElement(name, attributes);
+    if (selfClosing && !isVoidElement(name)) {
+        endElement(name);
+    }
+    return pos;
+}
+
+void HtmlSanitizer::startElement(const QString &name, const QHash<QString, QString> &attributes)
+{
+    if (name == QLatin1String("br")) {
+        if (m_pendingBlock) {
+            startBlock(false);
+        }
+        // Held back, as a line break at the end of a block is not shown
+        if (m_elements.isEmpty() || !m_elements.last().emptyParagraph) {
+            if (m_pendingLineBreaks == 0) {
+                m_lineBreakFormat = charFormat();
+            }
+            ++m_pendingLineBreaks;
+        }
+        m_atBlockStart = false;
+        m_lastWasSpace = true;
+        return;
+    }
+    if (name == QLatin1String("hr")) {
+        if (supports(KRichTextWidget::SupportRuleLine)) {
+            insertRule();
+        } else {
+            m_pendingBlock = true;
+        }
+        return;
+    }
+    if (name == QLatin1String("meta")) {
+        if (attributes.value(QStringLiteral("name")).compare(QLatin1String("qrichtext"), Qt::CaseInsensitive) == 0
+                && attributes.value(QStringLiteral("content")) == QLatin1String("1")) {
+            m_qtRichText = true;
+        }
+        return;
+    }
+    if (isVoidElement(name)) {
+        return;
+    }
+
+    if (name == QLatin1String("p") || name == QLatin1String("li") || name == QLatin1String("dt")
+            || name == QLatin1String("dd") || name == QLatin1String("tr") || name == QLatin1String("td")
+            || name == QLatin1String("th")) {
+        closeImpliedElement(name);
+    }
+
+    Element element;
+    element.name = name;
+    element.charFormat = charFormat();
+    element.alignment = Qt::Alignment();
+    element.direction = Qt::LayoutDirectionAuto;
+    element.isList = false;
+    element.list = nullptr;
+    // QTextDocument makes its paragraphs pre-wrap with a style sheet
+    element.preformatted = name == QLatin1String("pre")
+                           || (m_qtRichText && (name == QLatin1String("p") || name == QLatin1String("li")))
+                           || (!m_elements.isEmpty() && m_elements.last().preformatted);
+    element.emptyParagraph = false;
+    applyAttributes(name, attributes, element);
+    const QString style = attributes.value(QStringLiteral("style"));
+    if (!style.isEmpty()) {
+        applyStyle(style, element);
+    }
+    m_elements.append(element);
+
+    if (isBlockElement(name)) {
+        m_pendingBlock = true;
+        if (name == QLatin1String("li")) {
+            m_pendingListItem = true;
+        }
+    } else if (name == QLatin1String("td") || name == QLatin1String("th")) {
+        // Cells of a row are separated by tabs
+        if (!m_atBlockStart && !m_pendingBlock) {
+            flushLineBreaks(false);
+            m_cursor->insertText(QStringLiteral("\t"), QTextCharFormat());
+            m_lastWasSpace = true;
+        }
+    }
+}
+
+void HtmlSanitizer::endElement(const QString &name)
+{
+    for (int i = m_elements.size() - 1; i >= 0; --i) {
+        if (m_elements.at(i).name == name) {
+            m_elements.resize(i);
+            if (isBlockElement(name)) {
+                m_pendingBlock = true;
+                m_pendingListItem = false;
+            }
+            return;
+        }
+    }
+}
+
+// Closes an open element of the same name, as in <li>one<li>two
+void HtmlSanitizer::closeImpliedElement(const QString &name)
+{
+    for (int i = m_elements.size() - 1; i >= 0; --i) {
+        const QString &open = m_elements.at(i).name;
+        if (open == name) {
+            endElement(name);
+            return;
+        }
+        if (isContainerElement(open)) {
+            return;
+        }
+    }
+}
+
+void HtmlSanitizer::applyAttributes(const QString &name, const QHash<QString, QString> &attributes, Element &element) const
+{
+    QTextCharFormat &format = element.charFormat;
+
+    if (name == QLatin1String("b") || name == QLatin1String("strong")) {
+        if (supports(KRichTextWidget::SupportBold)) {
+            format.setFontWeight(QFont::Bold);
+        }
+    } else if (name == QLatin1String("i") || name == QLatin1String("em") || name == QLatin1String("cite")
+               || name == QLatin1String("var") || name == QLatin1String("dfn")) {
+        if (supports(KRichTextWidget::SupportItalic)) {
+            format.setFontItalic(true);
+        }
+    } else if (name == QLatin1String("u") || name == QLatin1String("ins")) {
+        if (supports(KRichTextWidget::SupportUnderline)) {
+            format.setFontUnderline(true);
+        }
+    } else if (name == QLatin1String("s") || name == QLatin1String("strike") || name == QLatin1String("del")) {
+        if (supports(KRichTextWidget::SupportStrikeOut)) {
+            format.setFontStrikeOut(true);
+        }
+    } else if (name == QLatin1String("sup") || name == QLatin1String("sub")) {
+        if (supports(KRichTextWidget::SupportSuperScriptAndSubScript)) {
+            format.setVerticalAlignment(name == QLatin1String("sup") ? QTextCharFormat::AlignSuperScript
+                                                                     : QTextCharFormat::AlignSubScript);
+        }
+    } else if (name == QLatin1String("code") || name == QLatin1String("tt") || name == QLatin1String("kbd")
+               || name == QLatin1String("samp") || name == QLatin1String("pre")) {
+        if (supports(KRichTextWidget::SupportFontFamily)) {
+            format.setFontFamily(QStringLiteral("monospace"));
+            format.setFontFixedPitch(true);
+        }
+    } else if (name.size() == 2 && name.at(0) == QLatin1Char('h') && name.at(1) >= QLatin1Char('1')
+               && name.at(1) <= QLatin1Char('6')) {
+        if (supports(KRichTextWidget::SupportBold)) {
+            format.setFontWeight(QFont::Bold);
+        }
+        if (supports(KRichTextWidget::SupportFontSize)) {
+            // Same sizes as for headings in QTextDocument::setHtml()
+            format.setProperty(QTextFormat::FontSizeAdjustment, 4 - name.at(1).digitValue());
+        }
+    } else if (name == QLatin1String("a")) {
+        const QString href = safeHref(attributes.value(QStringLiteral("href")));
+        if (supports(KRichTextWidget::SupportHyperlinks) && !href.isEmpty()) {
+            const QColor linkColor = KColorScheme(QPalette::Active, KColorScheme::View).foreground(KColorScheme::LinkText).color();
+            format.setAnchor(true);
+            format.setAnchorHref(href);
+            format.setUnderlineStyle(QTextCharFormat::SingleUnderline);
+            format.setUnderlineColor(linkColor);
+            format.setForeground(linkColor);
+        }
+    } else if (name == QLatin1String("font")) {
+        const QString face = attributes.value(QStringLiteral("face"));
+        if (!face.isEmpty() && supports(KRichTextWidget::SupportFontFamily)) {
+            format.setFontFamily(firstFontFamily(face));
+        }
+        const QString size = attributes.value(QStringLiteral("size")).trimmed();
+        if (!size.isEmpty() && supports(KRichTextWidget::SupportFontSize)) {
+            bool ok = false;
+            const int value = size.toInt(&ok);
+            if (ok) {
+                const bool relative = size.startsWith(QLatin1Char('+')) || size.startsWith(QLatin1Char('-'));
+                format.setProperty(QTextFormat::FontSizeAdjustment, qBound(-2, relative ? value : value - 3, 4));
+            }
+        }
+        const QColor color = parseColor(attributes.value(QStringLiteral("color")));
+        if (color.isValid() && supports(KRichTextWidget::SupportTextForegroundColor)) {
+            format.setForeground(color);
+        }
+    } else if (name == QLatin1String("ul") || name == QLatin1String("ol")) {
+        if (m_support & KRichTextWidget::FullListSupport) {
+            int depth = 0;
+            for (const Element &open : qAsConst(m_elements)) {
+                if (open.isList) {
+                    ++depth;
+                }
+            }
+            const QString type = attributes.value(QStringLiteral("type"));
+            QTextListFormat::Style style;
+            if (name == QLatin1String("ul")) {
+                static const QTextListFormat::Style bullets[] = {
+                    QTextListFormat::ListDisc, QTextListFormat::ListCircle, QTextListFormat::ListSquare
+                };
+                style = bullets[depth % 3];
+                if (type.compare(QLatin1String("circle"), Qt::CaseInsensitive) == 0) {
+                    style = QTextListFormat::ListCircle;
+                } else if (type.compare(QLatin1String("square"), Qt::CaseInsensitive) == 0) {
+                    style = QTextListFormat::ListSquare;
+                } else if (type.compare(QLatin1String("disc"), Qt::CaseInsensitive) == 0) {
+                    style = QTextListFormat::ListDisc;
+                }
+            } else if (type == QLatin1String("a")) {
+                style = QTextListFormat::ListLowerAlpha;
+            } else if (type == QLatin1String("A")) {
+                style = QTextListFormat::ListUpperAlpha;
+            } else if (type == QLatin1String("i")) {
+                style = QTextListFormat::ListLowerRoman;
+            } else if (type == QLatin1String("I")) {
+                style = QTextListFormat::ListUpperRoman;
+            } else {
+                style = QTextListFormat::ListDecimal;
+            }
+            element.isList = true;
+            element.listFormat.setStyle(style);
+            element.listFormat.setIndent(depth + 1);
+        }
+    }
+
+    const QString align = attributes.value(QStringLiteral("align"));
+    if (!align.isEmpty() && supports(KRichTextWidget::SupportAlignment)) {
+        element.alignment = parseAlignment(align);
+    }
+    const QString dir = attributes.value(QStringLiteral("dir"));
+    if (!dir.isEmpty() && supports(KRichTextWidget::SupportDirection)) {
+        element.direction = parseDirection(dir);
+    }
+}
+
+void HtmlSanitizer::applyStyle(const QString &style, Element &element) const
+{
+    QTextCharFormat &format = element.charFormat;
+    const QVector<QStringRef> declarations = style.splitRef(QLatin1Char(';'), QString::SkipEmptyParts);
+    for (const QStringRef &declaration : declarations) {
+        const int colon = declaration.indexOf(QLatin1Char(':'));
+        if (colon == -1) {
+            continue;
+        }
+        const QString property = declaration.left(colon).trimmed().toString().toLower();
+        QString value = declaration.mid(colon + 1).trimmed().toString();
+        value.remove(QLatin1String("!important"), Qt::CaseInsensitive);
+        value = value.trimmed();
+        const QString lowerValue = value.toLower();
+
+        if (property == QLatin1String("font-weight")) {
+            if (supports(KRichTextWidget::SupportBold)) {
+                bool numeric = false;
+                const int weight = lowerValue.toInt(&numeric);
+                const bool bold = numeric ? weight >= 600 : (lowerValue == QLatin1String("bold") || lowerValue == QLatin1String("bolder"));
+                format.setFontWeight(bold ? QFont::Bold : QFont::Normal);
+            }
+        } else if (property == QLatin1String("font-style")) {
+            if (supports(KRichTextWidget::SupportItalic)) {
+                format.setFontItalic(lowerValue == QLatin1String("italic") || lowerValue == QLatin1String("oblique"));
+            }
+        } else if (property == QLatin1String("text-decoration") || property == QLatin1String("text-decoration-line")) {
+            if (supports(KRichTextWidget::SupportUnderline)) {
+                format.setFontUnderline(lowerValue.contains(QLatin1String("underline")));
+            }
+            if (supports(KRichTextWidget::SupportStrikeOut)) {
+                format.setFontStrikeOut(lowerValue.contains(QLatin1String("line-through")));
+            }
+        } else if (property == QLatin1String("color")) {
+            const QColor color = parseColor(value);
+            if (color.isValid() && supports(KRichTextWidget::SupportTextForegroundColor) && !format.isAnchor()) {
+                format.setForeground(color);
+            }
+        } else if (property == QLatin1String("background-color") || property == QLatin1String("background")) {
+            const QColor color = parseColor(value);
+            if (color.isValid() && supports(KRichTextWidget::SupportTextBackgroundColor)) {
+                format.setBackground(color);
+            }
+        } else if (property == QLatin1String("font-family")) {
+            if (supports(KRichTextWidget::SupportFontFamily)) {
+                format.setFontFamily(firstFontFamily(value));
+            }
+        } else if (property == QLatin1String("font-size")) {
+            if (supports(KRichTextWidget::SupportFontSize)) {
+                bool ok = false;
+                if (lowerValue.endsWith(QLatin1String("pt"))) {
+                    const qreal size = lowerValue.leftRef(lowerValue.size() - 2).toDouble(&ok);
+                    if (ok && size > 0) {
+                        format.setFontPointSize(size);
+                    }
+                } else if (lowerValue.endsWith(QLatin1String("px"))) {
+                    const qreal size = lowerValue.leftRef(lowerValue.size() - 2).toDouble(&ok);
+                    if (ok && size > 0) {
+                        format.setFontPointSize(size * 0.75);
+                    }
+                }
+            }
+        } else if (property == QLatin1String("vertical-align")) {
+            if (supports(KRichTextWidget::SupportSuperScriptAndSubScript)) {
+                if (lowerValue == QLatin1String("super")) {
+                    format.setVerticalAlignment(QTextCharFormat::AlignSuperScript);
+                } else if (lowerValue == QLatin1String("sub")) {
+                    format.setVerticalAlignment(QTextCharFormat::AlignSubScript);
+                }
+            }
+        } else if (property == QLatin1String("text-align")) {
+            if (supports(KRichTextWidget::SupportAlignment)) {
+                element.alignment = parseAlignment(value);
+            }
+        } else if (property == QLatin1String("direction")) {
+            if (supports(KRichTextWidget::SupportDirection)) {
+                element.direction = parseDirection(value);
+            }
+        } else if (property == QLatin1String("white-space")) {
+            element.preformatted = lowerValue == QLatin1String("pre") || lowerValue == QLatin1String("pre-wrap");
+        } else if (property == QLatin1String("-qt-paragraph-type")) {
+            element.emptyParagraph = lowerValue == QLatin1String("empty");
+        }
+    }
+}
+
+void HtmlSanitizer::appendText(const QString &text)
+{
+    const bool preformatted = isPreformatted();
+    QString run;
+    run.reserve(text.size());
+    for (const QChar c : text) {
+        if (preformatted) {
+            if (m_pendingBlock) {
+                startBlock(false);
+            }
+            if (c == QLatin1Char('\r')) {
+                continue;
+            }
+            if (c == QLatin1Char('\n')) {
+                insertRun(run);
+                flushLineBreaks(false);
+                startBlock(true);
+                continue;
+            }
+            run += c;
+            continue;
+        }
+        if (isHtmlSpace(c)) {
+            if (!m_lastWasSpace && !m_pendingBlock && !(m_atBlockStart && run.isEmpty())) {
+                run += QLatin1Char(' ');
+                m_lastWasSpace = true;
+            }
+            continue;
+        }
+        if (m_pendingBlock) {
+            startBlock(false);
+        }
+        run += c;
+        m_lastWasSpace = false;
+    }
+    insertRun(run);
+}
+
+void HtmlSanitizer::insertRun(QString &run)
+{
+    if (run.isEmpty()) {
+        return;
+    }
+    flushLineBreaks(false);
+    m_cursor->insertText(run, charFormat());
+    m_atBlockStart = false;
+    run.clear();
+}
+
+void HtmlSanitizer::startBlock(bool force)
+{
+    flushLineBreaks(true);
+    m_pendingBlock = false;
+    if (force || !m_atBlockStart) {
+        m_cursor->insertBlock(blockFormat(), QTextCharFormat());
+        m_ownsBlock = true;
+    } else if (m_ownsBlock) {
+        m_cursor->setBlockFormat(blockFormat());
+    }
+    m_atBlockStart = true;
+    m_lastWasSpace = false;
+    if (m_pendingListItem) {
+        m_pendingListItem = false;
+        addListItem();
+    }
+}
+
+// Inserts the held back line breaks, but the last one if the block ends
+// after them
+void HtmlSanitizer::flushLineBreaks(bool blockEnd)
+{
+    const int count = blockEnd ? m_pendingLineBreaks - 1 : m_pendingLineBreaks;
+    if (count > 0) {
+        m_cursor->insertText(QString(count, QChar::LineSeparator), m_lineBreakFormat);
+    }
+    m_pendingLineBreaks = 0;
+}
+
+void HtmlSanitizer::insertRule()
+{
+    flushLineBreaks(true);
+    QTextBlockFormat format = blockFormat();
+    format.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth, QTextLength(QTextLength::PercentageLength, 100));
+    if (m_atBlockStart && m_ownsBlock) {
+        m_cursor->setBlockFormat(format);
+    } else {
+        m_cursor->insertBlock(format, QTextCharFormat());
+    }
+    // The rule takes the whole block, the text continues in the next one
+    m_ownsBlock = true;
+    m_atBlockStart = false;
+    m_pendingBlock = true;
+}
+
+void HtmlSanitizer::addListItem()
+{
+    if (!m_ownsBlock) {
+        return;
+    }
+    for (int i = m_elements.size() - 1; i >= 0; --i) {
+        Element &element = m_elements[i];
+        if (!element.isList) {
+            continue;
+        }
+        if (element.list) {
+            element.list->add(m_cursor->block());
+        } else {
+            element.list = m_cursor->createList(element.listFormat);
+        }
+        return;
+    }
+}
+
+bool HtmlSanitizer::isPreformatted() const
+{
+    return !m_elements.isEmpty() && m_elements.last().preformatted;
+}
+
+QTextCharFormat HtmlSanitizer::charFormat() const
+{
+    return m_elements.isEmpty() ? QTextCharFormat() : m_elements.last().charFormat;
+}
+
+QTextBlockFormat HtmlSanitizer::blockFormat() const
+{
+    QTextBlockFormat format;
+    bool alignmentFound = false;
+    bool directionFound = false;
+    for (int i = m_elements.size() - 1; i >= 0 && !(alignmentFound && directionFound); --i) {
+        const Element &element = m_elements.at(i);
+        if (!alignmentFound && element.alignment) {
+            format.setAlignment(element.alignment);
+            alignmentFound = true;
+        }
+        if (!directionFound && element.direction != Qt::LayoutDirectionAuto) {
+            format.setLayoutDirection(element.direction);
+            directionFound = true;
+        }
+    }
+    return format;
+}
+
+bool HtmlSanitizer::supports(KRichTextWidget::RichTextSupportValues feature) const
+{
+    return m_support & feature;
+}
+
+//@endcond
@@ -0,0 +1,114 @@
+/**
+ * HTML sanitizer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef HTMLSANITIZER_H
+#define HTMLSANITIZER_H
+
+//@cond PRIVATE
+
+#include <QHash>
+#include <QString>
+#include <QTextCharFormat>
+#include <QTextListFormat>
+#include <QVector>
+
+#include "krichtextwidget.h"
+
+class QTextCursor;
+class QTextList;
+
+/**
+ * @short Inserts HTML keeping only the formatting a KRichTextWidget supports
+ *
+ * The HTML is read in a single pass and the text is inserted directly at a
+ * cursor, without building a QTextDocumentFragment first. Only formatting
+ * enabled in the given RichTextSupport is kept. Images, tables, style sheets,
+ * scripts and unknown elements are dropped, the text of table cells is kept
+ * separated by tabs. Whitespace is collapsed like in a browser, except in
+ * preformatted elements. HTML written by QTextDocument keeps its whitespace,
+ * as its paragraphs are preformatted by a style sheet.
+ *
+ * The whole insertion is a single undo step.
+ *
+ * @internal
+ */
+class HtmlSanitizer
+{
+public:
+    explicit HtmlSanitizer(KRichTextWidget::RichTextSupport support);
+
+    /**
+     * Inserts @p html at @p cursor, which is left after the inserted text.
+     */
+    void insert(const QString &html, QTextCursor &cursor);
+
+private:
+    struct Element {
+        QString name;
+        QTextCharFormat charFormat;
+        Qt::Alignment alignment;
+        Qt::LayoutDirection direction;
+        bool isList;
+        QTextListFormat listFormat;
+        QTextList *list;
+        // white-space: pre or pre-wrap, inherited by the child elements
+        bool preformatted;
+        // A paragraph QTextDocument marked as empty
+        bool emptyParagraph;
+    };
+
+    int parseTag(const QString &html, int start);
+    void startElement(const QString &name, const QHash<QString, QString> &attributes);
+    void endElement(const QString &name);
+    void closeImpliedElement(const QString &name);
+    void applyAttributes(const QString &name, const QHash<QString, QString> &attributes, Element &element) const;
+    void applyStyle(const QString &style, Element &element) const;
+    void appendText(const QString &text);
+    void insertRun(QString &run);
+    void startBlock(bool force);
+    void flushLineBreaks(bool blockEnd);
+    void insertRule();
+    void addListItem();
+    bool isPreformatted() const;
+    QTextCharFormat charFormat() const;
+    QTextBlockFormat blockFormat() const;
+    bool supports(KRichTextWidget::RichTextSupportValues feature) const;
+
+    KRichTextWidget::RichTextSupport m_support;
+    QTextCursor *m_cursor;
+    QVector<Element> m_elements;
+    // A block element started or ended, so the next text needs a new block
+    bool m_pendingBlock;
+    // An li element started, so the next block is a list item
+    bool m_pendingListItem;
+    // Nothing was inserted into the current block yet
+    bool m_atBlockStart;
+    // The current block was created by the sanitizer or was empty before
+    bool m_ownsBlock;
+    bool m_lastWasSpace;
+    // The HTML was written by QTextDocument
+    bool m_qtRichText;
+    // Line breaks not inserted yet, dropped if they end a block
+    int m_pendingLineBreaks;
+    QTextCharFormat m_lineBreakFormat;
+};
+
+//@endcond
+
+#endif
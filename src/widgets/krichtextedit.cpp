@@ -25,6 +25,8 @@
 
 // Own includes
 #include "nestedlisthelper_p.h"
+#include "markdownhelper_p.h"
+#include "linkindex_p.h"
 #include "klinkdialog_p.h"
 
 // kdelibs includes
@@ -32,6 +34,16 @@
 #include <kcolorscheme.h>
 
 // Qt includes
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTextBlock>
+#include <QTextFrame>
+#include <QTimer>
+
+#include <algorithm>
+
+// Marks the character format of links created by auto linking
+static const int s_autoLinkProperty = QTextFormat::UserProperty + 0x4b52;
 
 /**
   Private class that helps to provide binary compatibility between releases.
@@ -46,10 +58,29 @@ public:
           mMode(KRichTextEdit::Plain)
     {
         nestedListHelper = new NestedListHelper(q);
+        linkIndex = new LinkIndex(q);
+
+        autoLinkTimer.setSingleShot(true);
+        autoLinkTimer.setInterval(0);
+        connect(&autoLinkTimer, &QTimer::timeout, this, [this]() {
+            updateAutoLinks();
+        });
+        // Links are added to pasted text at once when the paste is done,
+        // keeping the paste a single undo step
+        connect(q, &KTextEdit::chunkedPasteFinished, this, [this]() {
+            if (!autoLinkRange.isNull()) {
+                autoLinkTimer.start();
+            }
+        });
+        // QTextEdit announces a new document only with this signal
+        connect(q, &QTextEdit::cursorPositionChanged, this, [this]() {
+            watchAutoLinkDocument();
+        });
     }
 
     ~KRichTextEditPrivate()
     {
+        delete linkIndex;
         delete nestedListHelper;
     }
 
@@ -73,12 +104,44 @@ public:
 
     void setTextCursor(QTextCursor &cursor);
 
+    // Returns the character format which makes text look like a link.
+    QTextCharFormat linkCharFormat() const;
+
+    // Returns the format to merge to make text a link to url, or no link if
+    // url is empty.
+    QTextCharFormat linkFormat(const QString &url, bool automatic) const;
+
+    // Follows the changes of the current document while auto linking is
+    // enabled.
+    void watchAutoLinkDocument();
+
+    // Remembers the text changed while auto linking is enabled.
+    void autoLinkContentsChange(int position, int charsRemoved, int charsAdded);
+
+    // Links the URLs in the changed blocks.
+    void updateAutoLinks();
+    void updateAutoLinks(const QTextBlock &block, int cursorPosition, QTextCursor &cursor, bool *editing);
+
+    // Returns the public links for entries of the link index.
+    QVector<KRichTextEdit::Link> toLinks(const QVector<LinkIndex::Entry> &entries) const;
+
     // Data members
 
     KRichTextEdit *q;
     KRichTextEdit::Mode mMode;
 
     NestedListHelper *nestedListHelper;
+    LinkIndex *linkIndex;
+
+    bool autoLinkingEnabled = false;
+    bool applyingAutoLinks = false;
+    // Whether all changes since the last update were single typed characters
+    bool autoLinkTyped = false;
+    // Covers the text changed since the last update
+    QTextCursor autoLinkRange;
+    QTimer autoLinkTimer;
+    QPointer<QTextDocument> autoLinkDocument;
+    QMetaObject::Connection autoLinkConnection;
 
 };
 
@@ -96,6 +159,227 @@ void KRichTextEditPrivate::setTextCursor(QTextCursor &cursor)
     q->setTextCursor(cursor);
 }
 
+QTextCharFormat KRichTextEditPrivate::linkCharFormat() const
+{
+    const QColor linkColor = KColorScheme(QPalette::Active, KColorScheme::View).foreground(KColorScheme::LinkText).color();
+    QTextCharFormat format;
+    // Workaround for QTBUG-1814:
+    // Link formatting does not get applied immediately when setAnchor(true)
+    // is called.  So the formatting needs to be applied manually.
+    format.setUnderlineStyle(QTextCharFormat::SingleUnderline);
+    format.setUnderlineColor(linkColor);
+    format.setForeground(linkColor);
+    return format;
+}
+
+QTextCharFormat KRichTextEditPrivate::linkFormat(const QString &url, bool automatic) const
+{
+    QTextCharFormat format;
+    if (!url.isEmpty()) {
+        format.setAnchor(true);
+        format.setAnchorHref(url);
+        format.merge(linkCharFormat());
+    } else {
+        format.setAnchor(false);
+        format.setAnchorHref(QString());
+        // Workaround for QTBUG-1814:
+        // Link formatting does not get removed immediately when setAnchor(false)
+        // is called. So the formatting needs to be applied manually.
+        QTextDocument defaultTextDocument;
+        QTextCharFormat defaultCharFormat = defaultTextDocument.begin().charFormat();
+
+        format.setUnderlineStyle(defaultCharFormat.underlineStyle());
+        format.setUnderlineColor(defaultCharFormat.underlineColor());
+        format.setForeground(defaultCharFormat.foreground());
+    }
+    format.setProperty(s_autoLinkProperty, automatic);
+    return format;
+}
+
+void KRichTextEditPrivate::watchAutoLinkDocument()
+{
+    QTextDocument *doc = q->document();
+    if (!autoLinkingEnabled || autoLinkDocument == doc) {
+        return;
+    }
+    disconnect(autoLinkConnection);
+    autoLinkTimer.stop();
+    autoLinkRange = QTextCursor();
+    autoLinkDocument = doc;
+    autoLinkConnection = connect(doc, &QTextDocument::contentsChange, this,
+    [this](int position, int charsRemoved, int charsAdded) {
+        autoLinkContentsChange(position, charsRemoved, charsAdded);
+    });
+}
+
+void KRichTextEditPrivate::autoLinkContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (applyingAutoLinks) {
+        return;
+    }
+
+    QTextDocument *doc = q->document();
+    if (position == 0 && charsAdded >= doc->characterCount() - 1) {
+        // All text was replaced, like with setHtml()
+        return;
+    }
+    const int end = qMin(position + charsAdded, doc->characterCount() - 1);
+    const bool typed = charsAdded == 1 && charsRemoved == 0;
+    if (autoLinkRange.isNull()) {
+        autoLinkTyped = typed;
+        autoLinkRange = QTextCursor(doc);
+        autoLinkRange.setPosition(position);
+    } else {
+        autoLinkTyped = autoLinkTyped && typed;
+        const int start = qMin(position, autoLinkRange.selectionStart());
+        const int oldEnd = autoLinkRange.selectionEnd();
+        autoLinkRange.setPosition(start);
+        autoLinkRange.setPosition(qMax(end, oldEnd), QTextCursor::KeepAnchor);
+        autoLinkTimer.start();
+        return;
+    }
+    autoLinkRange.setPosition(end, QTextCursor::KeepAnchor);
+    autoLinkTimer.start();
+}
+
+void KRichTextEditPrivate::updateAutoLinks()
+{
+    if (autoLinkRange.isNull() || q->isChunkedPasteActive()) {
+        return;
+    }
+    QTextDocument *doc = q->document();
+    const QTextCursor range = autoLinkRange;
+    autoLinkRange = QTextCursor();
+    if (range.document() != doc) {
+        return;
+    }
+
+    // While typing, the URL ending at the cursor may not be complete yet
+    const int cursorPosition = autoLinkTyped ? q->textCursor().position() : -1;
+
+    applyingAutoLinks = true;
+    QTextCursor cursor(doc);
+    bool editing = false;
+    const QTextBlock last = doc->findBlock(range.selectionEnd());
+    for (QTextBlock block = doc->findBlock(range.selectionStart()); block.isValid(); block = block.next()) {
+        updateAutoLinks(block, cursorPosition, cursor, &editing);
+        if (block == last) {
+            break;
+        }
+    }
+    if (editing) {
+        cursor.endEditBlock();
+        activateRichText();
+    }
+    applyingAutoLinks = false;
+}
+
+void KRichTextEditPrivate::updateAutoLinks(const QTextBlock &block, int cursorPosition,
+                                           QTextCursor &cursor, bool *editing)
+{
+    static const QRegularExpression urlPattern(QStringLiteral(
+                "(?:\\b(?:https?|ftp)://|\\bwww\\.)[^\\s<>\"]+|\\b[\\w.+-]+@[\\w-]+(?:\\.[\\w-]+)+"),
+            QRegularExpression::UseUnicodePropertiesOption);
+    static const QString trailingPunctuation = QStringLiteral(".,;:!?)'\"");
+
+    struct Range {
+        int start;
+        int end;
+        QString href;   // Empty for a URL which is not complete yet
+    };
+    QVector<Range> urls;
+    const QString text = block.text();
+    QRegularExpressionMatchIterator matches = urlPattern.globalMatch(text);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        QString url = match.captured();
+        // Trailing punctuation usually ends the sentence, not the URL
+        while (!url.isEmpty() && trailingPunctuation.contains(url.at(url.size() - 1))) {
+            url.chop(1);
+        }
+        const int start = block.position() + match.capturedStart();
+        const int end = start + url.size();
+        QString href;
+        if (end != cursorPosition) {
+            if (url.startsWith(QLatin1String("www."), Qt::CaseInsensitive)) {
+                href = QLatin1String("http://") + url;
+            } else if (!url.contains(QLatin1String("://"))) {
+                href = QLatin1String("mailto:") + url;
+            } else {
+                href = url;
+            }
+        }
+        urls.append({start, end, href});
+    }
+
+    // The formats of the block, to compare the URLs to the existing links
+    QVector<Range> autoLinks;
+    QVector<Range> manualLinks;
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        const QTextFragment fragment = it.fragment();
+        const QTextCharFormat format = fragment.charFormat();
+        if (format.isAnchor()) {
+            const Range range = {fragment.position(), fragment.position() + fragment.length(), format.anchorHref()};
+            (format.boolProperty(s_autoLinkProperty) ? autoLinks : manualLinks).append(range);
+        }
+    }
+
+    const auto apply = [&cursor, editing](int start, int end, const QTextCharFormat &format) {
+        if (!*editing) {
+            cursor.beginEditBlock();
+            *editing = true;
+        }
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        cursor.mergeCharFormat(format);
+    };
+
+    // Remove automatic links whose text is no URL anymore
+    for (const Range &link : qAsConst(autoLinks)) {
+        const bool covered = std::any_of(urls.cbegin(), urls.cend(), [&link](const Range &url) {
+            return link.start >= url.start && link.end <= url.end;
+        });
+        if (!covered) {
+            apply(link.start, link.end, linkFormat(QString(), false));
+        }
+    }
+
+    for (const Range &url : qAsConst(urls)) {
+        if (url.href.isEmpty()) {
+            continue;
+        }
+        const auto overlaps = [&url](const Range &link) {
+            return link.start < url.end && link.end > url.start;
+        };
+        if (std::any_of(manualLinks.cbegin(), manualLinks.cend(), overlaps)) {
+            continue;
+        }
+        // Already linked if automatic links to it cover all of the URL
+        int linked = 0;
+        for (const Range &link : qAsConst(autoLinks)) {
+            if (overlaps(link) && link.href == url.href) {
+                linked += qMin(link.end, url.end) - qMax(link.start, url.start);
+            }
+        }
+        if (linked != url.end - url.start) {
+            apply(url.start, url.end, linkFormat(url.href, true));
+        }
+    }
+}
+
+QVector<KRichTextEdit::Link> KRichTextEditPrivate::toLinks(const QVector<LinkIndex::Entry> &entries) const
+{
+    QVector<KRichTextEdit::Link> links;
+    links.reserve(entries.size());
+    QTextCursor cursor(q->document());
+    for (const LinkIndex::Entry &entry : entries) {
+        cursor.setPosition(entry.start);
+        cursor.setPosition(entry.end, QTextCursor::KeepAnchor);
+        links.append({entry.start, entry.end - entry.start, entry.href, cursor.selectedText()});
+    }
+    return links;
+}
+
 void KRichTextEditPrivate::mergeFormatOnWordOrSelection(const QTextCharFormat &format)
 {
     QTextCursor cursor = q->textCursor();
@@ -316,7 +600,23 @@ void KRichTextEdit::switchToPlainText()
 
 void KRichTextEdit::insertPlainTextImplementation()
 {
-    document()->setPlainText(document()->toPlainText());
+    QTextDocument *doc = document();
+    if (!doc->rootFrame()->childFrames().isEmpty()) {
+        // Tables and other frames are flattened by going through plain text
+        doc->setPlainText(doc->toPlainText());
+        return;
+    }
+
+    // Strip the formats in place instead of rebuilding the document from a
+    // copy of its text. This keeps the blocks, the undo history and the
+    // memory usage as they are. Resetting the block formats also removes
+    // the blocks from their lists.
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    cursor.select(QTextCursor::Document);
+    cursor.setBlockFormat(QTextBlockFormat());
+    cursor.setCharFormat(QTextCharFormat());
+    cursor.endEditBlock();
 }
 
 void KRichTextEdit::setTextSuperScript(bool superscript)
@@ -359,14 +659,43 @@ QString KRichTextEdit::textOrHtml() const
 void KRichTextEdit::setTextOrHtml(const QString &text)
 {
     // might be rich text
-    if (Qt::mightBeRichText(text)) {
-        if (d->mMode == KRichTextEdit::Plain) {
-            d->activateRichText();
-        }
+    const bool richText = Qt::mightBeRichText(text);
+    if (richText && d->mMode == KRichTextEdit::Plain) {
+        d->activateRichText();
+    }
+
+    // Replacing a large text is a lot faster if nothing reacts to each of the
+    // inserted blocks. Detach the spell checking highlighter, which rechecks
+    // the whole document once it is attached again, and hold back repaints.
+    // The signals of the text edit are not blocked: QTextEdit emits each of
+    // them once after loading, and the undo, redo and copy states have to
+    // reach the actions.
+    Sonnet::Highlighter *spellHighlighter = highlighter();
+    if (spellHighlighter) {
+        spellHighlighter->setDocument(nullptr);
+    }
+    viewport()->setUpdatesEnabled(false);
+    if (richText) {
         setHtml(text);
     } else {
         setPlainText(text);
     }
+    if (spellHighlighter) {
+        spellHighlighter->setDocument(document());
+    }
+    viewport()->setUpdatesEnabled(true);
+    viewport()->update();
+}
+
+void KRichTextEdit::setMarkdownText(const QString &markdown)
+{
+    d->activateRichText();
+    MarkdownHelper::importMarkdown(document(), markdown, d->linkCharFormat());
+}
+
+QString KRichTextEdit::toMarkdownText() const
+{
+    return MarkdownHelper::exportMarkdown(document());
 }
 
 QString KRichTextEdit::currentLinkText() const
@@ -385,31 +714,22 @@ void KRichTextEdit::selectLinkText() const
 
 void KRichTextEdit::selectLinkText(QTextCursor *cursor) const
 {
-    // If the cursor is on a link, select the text of the link.
+    const LinkIndex::Entry *link = nullptr;
     if (cursor->charFormat().isAnchor()) {
-        QString aHref = cursor->charFormat().anchorHref();
-
-        // Move cursor to start of link
-        while (cursor->charFormat().anchorHref() == aHref) {
-            if (cursor->atStart()) {
-                break;
-            }
-            cursor->setPosition(cursor->position() - 1);
-        }
-        if (cursor->charFormat().anchorHref() != aHref) {
-            cursor->setPosition(cursor->position() + 1, QTextCursor::KeepAnchor);
+        // The format of the cursor is the one of the character before it,
+        // or of the first character at the start of a block.
+        const QTextBlock block = cursor->block();
+        int position = cursor->position();
+        if (position != block.position() || block.length() == 1) {
+            --position;
         }
+        link = d->linkIndex->entryAt(position);
+    }
 
-        // Move selection to the end of the link
-        while (cursor->charFormat().anchorHref() == aHref) {
-            if (cursor->atEnd()) {
-                break;
-            }
-            cursor->setPosition(cursor->position() + 1, QTextCursor::KeepAnchor);
-        }
-        if (cursor->charFormat().anchorHref() != aHref) {
-            cursor->setPosition(cursor->position() - 1, QTextCursor::KeepAnchor);
-        }
+    // If the cursor is on a link, select the text of the link.
+    if (link) {
+        cursor->setPosition(link->start);
+        cursor->setPosition(link->end, QTextCursor::KeepAnchor);
     } else if (cursor->hasSelection()) {
         // Nothing to to. Using the currently selected text as the link text.
     } else {
@@ -420,6 +740,34 @@ void KRichTextEdit::selectLinkText(QTextCursor *cursor) const
     }
 }
 
+QVector<KRichTextEdit::Link> KRichTextEdit::links() const
+{
+    return d->toLinks(d->linkIndex->entries());
+}
+
+QVector<KRichTextEdit::Link> KRichTextEdit::links(int from, int to) const
+{
+    return d->toLinks(d->linkIndex->entries(from, to));
+}
+
+void KRichTextEdit::setAutoLinkingEnabled(bool enabled)
+{
+    if (d->autoLinkingEnabled == enabled) {
+        return;
+    }
+    d->autoLinkingEnabled = enabled;
+    disconnect(d->autoLinkConnection);
+    d->autoLinkTimer.stop();
+    d->autoLinkRange = QTextCursor();
+    d->autoLinkDocument.clear();
+    d->watchAutoLinkDocument();
+}
+
+bool KRichTextEdit::isAutoLinkingEnabled() const
+{
+    return d->autoLinkingEnabled;
+}
+
 QString KRichTextEdit::currentLinkUrl() const
 {
     return textCursor().charFormat().anchorHref();
@@ -440,30 +788,10 @@ void KRichTextEdit::updateLink(const QString &linkUrl, const QString &linkText)
     // Save original format to create an extra space with the existing char
     // format for the block
     const QTextCharFormat originalFormat = format;
+    // Add or remove link details
+    format.merge(d->linkFormat(linkUrl, false));
     if (!linkUrl.isEmpty()) {
-        // Add link details
-        format.setAnchor(true);
-        format.setAnchorHref(linkUrl);
-        // Workaround for QTBUG-1814:
-        // Link formatting does not get applied immediately when setAnchor(true)
-        // is called.  So the formatting needs to be applied manually.
-        format.setUnderlineStyle(QTextCharFormat::SingleUnderline);
-        format.setUnderlineColor(KColorScheme(QPalette::Active, KColorScheme::View).foreground(KColorScheme::LinkText).color());
-        format.setForeground(KColorScheme(QPalette::Active, KColorScheme::View).foreground(KColorScheme::LinkText).color());
         d->activateRichText();
-    } else {
-        // Remove link details
-        format.setAnchor(false);
-        format.setAnchorHref(QString());
-        // Workaround for QTBUG-1814:
-        // Link formatting does not get removed immediately when setAnchor(false)
-        // is called. So the formatting needs to be applied manually.
-        QTextDocument defaultTextDocument;
-        QTextCharFormat defaultCharFormat = defaultTextDocument.begin().charFormat();
-
-        format.setUnderlineStyle(defaultCharFormat.underlineStyle());
-        format.setUnderlineColor(defaultCharFormat.underlineColor());
-        format.setForeground(defaultCharFormat.foreground());
     }
 
     // Insert link text specified in dialog, otherwise write out url.
@@ -488,8 +816,15 @@ void KRichTextEdit::updateLink(const QString &linkUrl, const QString &linkText)
 
 void KRichTextEdit::keyPressEvent(QKeyEvent *event)
 {
+    // Only Backspace and Return are handled by the list helper, so other keys
+    // do not need to look up the current list at all.
+    const bool listKey = event->key() == Qt::Key_Backspace || event->key() == Qt::Key_Return;
+    const QTextCursor cursorBefore = textCursor();
+    const int blockCount = document()->blockCount();
+    bool inList = listKey && cursorBefore.currentList();
+
     bool handled = false;
-    if (textCursor().currentList()) {
+    if (inList) {
         // handled is False if the key press event was not handled or not completely
         // handled by the Helper class.
         handled = d->nestedListHelper->handleBeforeKeyPressEvent(event);
@@ -499,10 +834,19 @@ void KRichTextEdit::keyPressEvent(QKeyEvent *event)
         KTextEdit::keyPressEvent(event);
     }
 
-    if (textCursor().currentList()) {
+    if (listKey && textCursor().currentList()) {
         d->nestedListHelper->handleAfterKeyPressEvent(event);
+        inList = true;
+    }
+
+    // QTextEdit announces moves of the cursor and changes of the character
+    // format itself. Only changes of the list or of the following blocks at
+    // the same position need to be announced here, so that the actions
+    // depending on them are updated.
+    if (inList || (textCursor().position() == cursorBefore.position()
+                   && document()->blockCount() != blockCount)) {
+        emit cursorPositionChanged();
     }
-    emit cursorPositionChanged();
 }
 
 // void KRichTextEdit::dropEvent(QDropEvent *event)
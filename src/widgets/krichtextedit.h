@@ -26,6 +26,8 @@
 
 #include <ktextedit.h>
 
+#include <QVector>
+
 class QKeyEvent;
 
 class KRichTextEditPrivate;
@@ -121,6 +123,29 @@ public:
      */
     void setTextOrHtml(const QString &text);
 
+    /**
+     * Replaces all the content of the text edit with the given Markdown text
+     * and enables rich text mode.
+     *
+     * The Markdown is parsed directly into the document, which is much faster
+     * than converting it to HTML first. Headings, paragraphs, block quotes,
+     * fenced code blocks, horizontal rules, nested lists, emphasis, strong
+     * emphasis, strike out, code spans and links are supported.
+     *
+     * @param markdown The Markdown text to insert
+     * @sa toMarkdownText
+     * @since 5.65
+     */
+    void setMarkdownText(const QString &markdown);
+
+    /**
+     * @return The content of the text edit as Markdown text. Formatting which
+     *         has no Markdown equivalent, such as colors and fonts, is lost.
+     * @sa setMarkdownText
+     * @since 5.65
+     */
+    QString toMarkdownText() const;
+
     /**
      * Returns the text of the link at the current position or an empty string
      * if the cursor is not on a link.
@@ -139,6 +164,44 @@ public:
      */
     QString currentLinkUrl() const;
 
+    /**
+     * A link in the text.
+     *
+     * @see links()
+     * @since 5.65
+     */
+    struct Link {
+        /// Position of the first character of the link
+        int position;
+        /// Number of characters of the link
+        int length;
+        /// The link target URL
+        QString url;
+        /// The text of the link, as displayed
+        QString text;
+    };
+
+    /**
+     * Returns all links in the text, ordered by their position.
+     *
+     * The links are kept in an index which is built on first use and then
+     * updated with every change of the text, so this is cheap to call
+     * repeatedly. A link continuing over several paragraphs is returned once,
+     * with QChar::ParagraphSeparator between the paragraphs in its text.
+     *
+     * @since 5.65
+     */
+    QVector<Link> links() const;
+
+    /**
+     * Returns the links with at least one character between the positions
+     * @p from and @p to, ordered by their position.
+     *
+     * @see links()
+     * @since 5.65
+     */
+    QVector<Link> links(int from, int to) const;
+
     /**
      * If the cursor is on a link, sets the @a cursor to a selection of the
      * text of the link. If the @a cursor is not on a link, selects the current word
@@ -169,6 +232,31 @@ public:
      */
     void updateLink(const QString &linkUrl, const QString &linkText);
 
+    /**
+     * Sets whether URLs and email addresses are turned into links while
+     * typing or pasting.
+     *
+     * Only the paragraphs touched by a change are searched, right after the
+     * change, so the cost does not depend on the length of the text. A URL is
+     * linked once it is complete, which is when the cursor has left it or it
+     * was inserted at once. Links created with updateLink() are never changed,
+     * links created automatically are updated or removed when their text
+     * changes. Linking text switches to rich text mode. Text replacing all of
+     * the content, like with setTextOrHtml(), is not linked.
+     *
+     * @param enabled Whether to link URLs automatically
+     * @sa isAutoLinkingEnabled
+     * @since 5.65
+     */
+    void setAutoLinkingEnabled(bool enabled);
+
+    /**
+     * @return whether URLs and email addresses are linked automatically.
+     * @sa setAutoLinkingEnabled
+     * @since 5.65
+     */
+    bool isAutoLinkingEnabled() const;
+
     /**
      * Returns true if the list item at the current position can be indented.
      *
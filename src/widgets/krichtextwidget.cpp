@@ -24,18 +24,88 @@
 #include <kcolorscheme.h>
 #include <kfontaction.h>
 #include <kfontsizeaction.h>
+#include <kselectaction.h>
 #include <klocalizedstring.h>
 #include <ktoggleaction.h>
 
 // Qt includes
 #include <QAction>
 #include <QColorDialog>
+#include <QFontDatabase>
+#include <QFontInfo>
+#include <QMenu>
+#include <QMimeData>
 #include <QTextList>
+#include <QTimer>
 
+#include "htmlsanitizer_p.h"
 #include "klinkdialog_p.h"
 
 // TODO: Add i18n context
 
+//@cond PRIVATE
+/**
+ * A font family action which only enumerates the installed fonts once it is
+ * shown in a menu or a toolbar, used when actions are created on demand.
+ * @internal
+ */
+class KRichTextFontAction : public KSelectAction
+{
+public:
+    KRichTextFontAction(const QString &text, QObject *parent)
+        : KSelectAction(text, parent)
+    {
+        setEditable(true);
+        // KSelectAction is disabled while it has no items, then the menu
+        // loading them could never be opened.
+        setEnabled(true);
+        connect(menu(), &QMenu::aboutToShow, this, [this]() {
+            loadFonts();
+        });
+    }
+
+    QString font() const
+    {
+        return m_fontsLoaded ? currentText() : m_font;
+    }
+
+    void setFont(const QString &family)
+    {
+        m_font = family;
+        if (m_fontsLoaded && !setCurrentAction(family, Qt::CaseInsensitive)) {
+            // Try the family the font is actually resolved to
+            setCurrentAction(QFontInfo(QFont(family)).family(), Qt::CaseInsensitive);
+        }
+    }
+
+protected:
+    QWidget *createWidget(QWidget *parent) override
+    {
+        loadFonts();
+        return KSelectAction::createWidget(parent);
+    }
+
+private:
+    void loadFonts()
+    {
+        if (m_fontsLoaded) {
+            return;
+        }
+        m_fontsLoaded = true;
+        // Adding the items enables the action, keep it disabled if it was
+        const bool enabled = isEnabled();
+        setItems(QFontDatabase().families());
+        setEnabled(enabled);
+        if (!m_font.isEmpty()) {
+            setFont(m_font);
+        }
+    }
+
+    QString m_font;
+    bool m_fontsLoaded = false;
+};
+//@endcond
+
 /**
   Private class that helps to provide binary compatibility between releases.
   @internal
@@ -70,6 +140,7 @@ public:
     KToggleAction *action_text_strikeout = nullptr;
 
     KFontAction *action_font_family = nullptr;
+    KRichTextFontAction *action_lazy_font_family = nullptr;
     KFontSizeAction *action_font_size = nullptr;
 
     KSelectAction *action_list_style = nullptr;
@@ -92,11 +163,36 @@ public:
     KToggleAction *action_text_superscript = nullptr;
     KToggleAction *action_text_subscript = nullptr;
 
+    // Pending updates while action state updates are coalesced
+    QTimer actionUpdateTimer;
+    bool coalesceActionUpdates = false;
+    bool charFormatActionsUpdatePending = false;
+    bool miscActionsUpdatePending = false;
+
+    bool createActionsOnDemand = false;
+
     //
     // Normal functions
     //
     void init();
 
+    /**
+     * Updates the actions relating to text format. Only actions whose
+     * state differs are touched.
+     */
+    void updateCharFormatActions(const QTextCharFormat &format);
+
+    /**
+     * Updates the alignment, list and direction actions. Only actions whose
+     * state differs are touched.
+     */
+    void updateMiscActions();
+
+    /**
+     * Runs the updates collected while coalescing.
+     */
+    void updatePendingActions();
+
     //
     // Slots
     //
@@ -129,12 +225,16 @@ public:
 
     /**
      * @brief Update actions relating to text format (bold, size etc.).
+     *
+     * While updates are coalesced, the update is deferred to the event loop.
      */
     void _k_updateCharFormatActions(const QTextCharFormat &format);
 
     /**
      * Update actions not covered by text formatting, such as alignment,
      * list style and level.
+     *
+     * While updates are coalesced, the update is deferred to the event loop.
      */
     void _k_updateMiscActions();
 
@@ -149,6 +249,12 @@ public:
 void KRichTextWidget::Private::init()
 {
     q->setRichTextSupport(KRichTextWidget::FullSupport);
+
+    actionUpdateTimer.setSingleShot(true);
+    actionUpdateTimer.setInterval(0);
+    QObject::connect(&actionUpdateTimer, &QTimer::timeout, q, [this]() {
+        updatePendingActions();
+    });
 }
 
 KRichTextWidget::KRichTextWidget(QWidget *parent)
@@ -221,14 +327,23 @@ QList<QAction *> KRichTextWidget::createActions()
         d->action_text_background_color = nullptr;
     }
 
-    if (d->richTextSupport & SupportFontFamily) {
+    if ((d->richTextSupport & SupportFontFamily) && d->createActionsOnDemand) {
+        //Font Family, with the fonts only enumerated when shown
+        d->action_font_family = nullptr;
+        d->action_lazy_font_family = new KRichTextFontAction(i18nc("@action", "&Font"), this);
+        d->richTextActionList.append((d->action_lazy_font_family));
+        d->action_lazy_font_family->setObjectName(QStringLiteral("format_font_family"));
+        connect(d->action_lazy_font_family, SIGNAL(triggered(QString)), this, SLOT(setFontFamily(QString)));
+    } else if (d->richTextSupport & SupportFontFamily) {
         //Font Family
         d->action_font_family = new KFontAction(i18nc("@action", "&Font"), this);
+        d->action_lazy_font_family = nullptr;
         d->richTextActionList.append((d->action_font_family));
         d->action_font_family->setObjectName(QStringLiteral("format_font_family"));
         connect(d->action_font_family, SIGNAL(triggered(QString)), this, SLOT(setFontFamily(QString)));
     } else {
         d->action_font_family = nullptr;
+        d->action_lazy_font_family = nullptr;
     }
 
     if (d->richTextSupport & SupportFontSize) {
@@ -496,8 +611,8 @@ QList<QAction *> KRichTextWidget::createActions()
     connect(this, SIGNAL(cursorPositionChanged()),
             this, SLOT(_k_updateMiscActions()));
 
-    d->_k_updateMiscActions();
-    d->_k_updateCharFormatActions(currentCharFormat());
+    d->updateMiscActions();
+    d->updateCharFormatActions(currentCharFormat());
 
     return d->richTextActionList;
 }
@@ -518,13 +633,57 @@ void KRichTextWidget::Private::_k_setListStyle(int index)
 
 void KRichTextWidget::Private::_k_updateCharFormatActions(const QTextCharFormat &format)
 {
+    if (coalesceActionUpdates) {
+        // The format is taken from the cursor once the update runs
+        charFormatActionsUpdatePending = true;
+        actionUpdateTimer.start();
+    } else {
+        updateCharFormatActions(format);
+    }
+}
+
+void KRichTextWidget::Private::_k_updateMiscActions()
+{
+    if (coalesceActionUpdates) {
+        miscActionsUpdatePending = true;
+        actionUpdateTimer.start();
+    } else {
+        updateMiscActions();
+    }
+}
+
+void KRichTextWidget::Private::updatePendingActions()
+{
+    actionUpdateTimer.stop();
+    if (miscActionsUpdatePending) {
+        miscActionsUpdatePending = false;
+        updateMiscActions();
+    }
+    if (charFormatActionsUpdatePending) {
+        charFormatActionsUpdatePending = false;
+        updateCharFormatActions(q->currentCharFormat());
+    }
+}
+
+void KRichTextWidget::Private::updateCharFormatActions(const QTextCharFormat &format)
+{
+    // Setting the font family and size updates their combo boxes even if
+    // the value did not change, so only set them when it did. Toggle actions
+    // ignore setting the state they already have.
     QFont f = format.font();
 
     if (richTextSupport & SupportFontFamily) {
-        action_font_family->setFont(f.family());
+        const QString family = f.family();
+        if (action_lazy_font_family) {
+            if (action_lazy_font_family->font() != family) {
+                action_lazy_font_family->setFont(family);
+            }
+        } else if (action_font_family->font() != family) {
+            action_font_family->setFont(family);
+        }
     }
     if (richTextSupport & SupportFontSize) {
-        if (f.pointSize() > 0) {
+        if (f.pointSize() > 0 && action_font_size->fontSize() != f.pointSize()) {
             action_font_size->setFontSize(f.pointSize());
         }
     }
@@ -552,7 +711,7 @@ void KRichTextWidget::Private::_k_updateCharFormatActions(const QTextCharFormat
     }
 }
 
-void KRichTextWidget::Private::_k_updateMiscActions()
+void KRichTextWidget::Private::updateMiscActions()
 {
     if (richTextSupport & SupportAlignment) {
         Qt::Alignment a = q->alignment();
@@ -568,10 +727,10 @@ void KRichTextWidget::Private::_k_updateMiscActions()
     }
 
     if (richTextSupport & SupportChangeListStyle) {
-        if (q->textCursor().currentList()) {
-            action_list_style->setCurrentItem(-q->textCursor().currentList()->format().style());
-        } else {
-            action_list_style->setCurrentItem(0);
+        const QTextList *list = q->textCursor().currentList();
+        const int item = list ? -list->format().style() : 0;
+        if (action_list_style->currentItem() != item) {
+            action_list_style->setCurrentItem(item);
         }
     }
 
@@ -658,6 +817,20 @@ void KRichTextWidget::mouseReleaseEvent(QMouseEvent *event)
     KRichTextEdit::mouseReleaseEvent(event);
 }
 
+void KRichTextWidget::insertFromMimeData(const QMimeData *source)
+{
+    if (!acceptRichText() || !source->hasHtml()) {
+        KRichTextEdit::insertFromMimeData(source);
+        return;
+    }
+
+    QTextCursor cursor = textCursor();
+    HtmlSanitizer sanitizer(d->richTextSupport);
+    sanitizer.insert(source->html(), cursor);
+    setTextCursor(cursor);
+    ensureCursorVisible();
+}
+
 void KRichTextWidget::Private::_k_formatPainter(bool active)
 {
     if (active) {
@@ -673,8 +846,37 @@ void KRichTextWidget::Private::_k_formatPainter(bool active)
 
 void KRichTextWidget::updateActionStates()
 {
-    d->_k_updateMiscActions();
-    d->_k_updateCharFormatActions(currentCharFormat());
+    d->miscActionsUpdatePending = false;
+    d->charFormatActionsUpdatePending = false;
+    d->actionUpdateTimer.stop();
+    d->updateMiscActions();
+    d->updateCharFormatActions(currentCharFormat());
+}
+
+void KRichTextWidget::setActionStateUpdatesCoalesced(bool coalesced)
+{
+    if (d->coalesceActionUpdates == coalesced) {
+        return;
+    }
+    d->coalesceActionUpdates = coalesced;
+    if (!coalesced) {
+        d->updatePendingActions();
+    }
+}
+
+bool KRichTextWidget::actionStateUpdatesCoalesced() const
+{
+    return d->coalesceActionUpdates;
+}
+
+void KRichTextWidget::setActionsCreatedOnDemand(bool onDemand)
+{
+    d->createActionsOnDemand = onDemand;
+}
+
+bool KRichTextWidget::actionsCreatedOnDemand() const
+{
+    return d->createActionsOnDemand;
 }
 
 #include "moc_krichtextwidget.cpp"
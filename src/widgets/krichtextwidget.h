@@ -100,8 +100,9 @@ public:
          * no text is selected, the font family of the word under the cursor is
          * changed.
          * Displayed as a combobox when inserted into the toolbar.
-         * This is a KFontAction. The status is automatically updated when
-         * the text cursor is moved.
+         * This is a KFontAction, or a KSelectAction if actionsCreatedOnDemand()
+         * is set. The status is automatically updated when the text cursor is
+         * moved.
          */
         SupportFontFamily = 0x10,
 
@@ -325,6 +326,57 @@ public:
      */
     void updateActionStates();
 
+    /**
+     * Sets whether updates of the action states are coalesced.
+     *
+     * By default the actions created by createActions() are updated right
+     * away on every change of the cursor position or the character format.
+     * When coalesced, the changes are collected and the actions are updated
+     * once when control returns to the event loop, which is cheaper while
+     * typing or when the text is changed programmatically.
+     *
+     * Switching coalescing off runs pending updates immediately.
+     * updateActionStates() always updates the actions immediately.
+     *
+     * @param coalesced Whether to coalesce the updates.
+     * @since 5.65
+     */
+    void setActionStateUpdatesCoalesced(bool coalesced);
+
+    /**
+     * @return whether updates of the action states are coalesced.
+     * @see setActionStateUpdatesCoalesced()
+     * @since 5.65
+     */
+    bool actionStateUpdatesCoalesced() const;
+
+    /**
+     * Sets whether createActions() defers expensive parts of the actions
+     * until they are needed.
+     *
+     * Enumerating the installed fonts for the font family action is the
+     * most expensive part of createActions(). If enabled, the fonts are
+     * only enumerated when the action is first shown in a menu or a
+     * toolbar. This helps windows which are created often but rarely show
+     * the formatting actions.
+     *
+     * The font family action is then a KSelectAction instead of a
+     * KFontAction.
+     *
+     * You need to call createActions() afterwards.
+     *
+     * @param onDemand Whether to create the actions on demand.
+     * @since 5.65
+     */
+    void setActionsCreatedOnDemand(bool onDemand);
+
+    /**
+     * @return whether createActions() defers expensive parts of the actions.
+     * @see setActionsCreatedOnDemand()
+     * @since 5.65
+     */
+    bool actionsCreatedOnDemand() const;
+
 public Q_SLOTS:
 
     /**
@@ -343,6 +395,18 @@ protected:
      */
     void mouseReleaseEvent(QMouseEvent *event) override;
 
+    /**
+     * Reimplemented.
+     * Inserts pasted or dropped HTML keeping only the formatting enabled by
+     * richTextSupport(). Everything else, like style sheets, images, tables
+     * and unsupported fonts or colors, is dropped while reading the HTML, so
+     * even large web pages are inserted quickly and result in a compact
+     * document. The insertion is a single undo step.
+     *
+     * @since 5.65
+     */
+    void insertFromMimeData(const QMimeData *source) override;
+
 private:
     //@cond PRIVATE
     class Private;
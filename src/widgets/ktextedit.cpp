@@ -22,13 +22,20 @@
 #include "ktextedit.h"
 
 #include <QAction>
+#include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QClipboard>
+#include <QContextMenuEvent>
+#include <QHash>
 #include <QKeyEvent>
 #include <QMenu>
+#include <QMimeData>
+#include <QPointer>
 #include <QScrollBar>
+#include <QTextBlock>
 #include <QTextCursor>
 #include <QTextDocumentFragment>
+#include <QTimer>
 #include <QDebug>
 #ifdef HAVE_SPEECH
 #include <QTextToSpeech>
@@ -39,14 +46,23 @@
 #include <sonnet/dialog.h>
 #include <sonnet/backgroundchecker.h>
 #include <sonnet/spellcheckdecorator.h>
+#include <kconfiggroup.h>
+#include <kconfigwatcher.h>
 #include <kcursor.h>
 #include <kstandardaction.h>
 #include <kicontheme.h>
 #include <kstandardshortcut.h>
 #include <klocalizedstring.h>
 #include <kmessagebox.h>
+#include <ksharedconfig.h>
 #include <kwindowsystem.h>
 
+#include "ktextedithighlighter_p.h"
+#include "ktexteditmimedata_p.h"
+#include "ktexteditsnapshot_p.h"
+#include "largedocumenthelper_p.h"
+#include "linediff_p.h"
+#include "spellcheckcache_p.h"
 #include "kreplacedialog.h"
 #include "kfinddialog.h"
 #include "kfind.h"
@@ -57,10 +73,102 @@ class KTextDecorator : public Sonnet::SpellCheckDecorator
 public:
     explicit KTextDecorator(KTextEdit *textEdit);
     bool isSpellCheckingEnabledForBlock(const QString &textBlock) const override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 private:
     KTextEdit *m_textEdit;
 };
 
+// The standard shortcuts handled by KTextEdit, in order of precedence: a key
+// bound to several shortcuts triggers the first one.
+static const KStandardShortcut::StandardShortcut s_handledShortcuts[] = {
+    KStandardShortcut::Copy, KStandardShortcut::Paste, KStandardShortcut::Cut,
+    KStandardShortcut::Undo, KStandardShortcut::Redo,
+    KStandardShortcut::DeleteWordBack, KStandardShortcut::DeleteWordForward,
+    KStandardShortcut::BackwardWord, KStandardShortcut::ForwardWord,
+    KStandardShortcut::Next, KStandardShortcut::Prior,
+    KStandardShortcut::Begin, KStandardShortcut::End,
+    KStandardShortcut::BeginningOfLine, KStandardShortcut::EndOfLine,
+    KStandardShortcut::Find, KStandardShortcut::FindNext,
+    KStandardShortcut::FindPrev, KStandardShortcut::Replace,
+    KStandardShortcut::PasteSelection
+};
+
+/**
+ * Maps the keys of the standard shortcuts handled by KTextEdit to their
+ * shortcut, so that each key press needs a single lookup. The table is
+ * shared by all KTextEdits, and built again after the shortcuts in the
+ * global configuration were changed and the change was announced.
+ */
+class KTextEditShortcuts
+{
+public:
+    KTextEditShortcuts()
+        : m_watcher(KConfigWatcher::create(KSharedConfig::openConfig())),
+          m_built(false)
+    {
+        QObject::connect(m_watcher.data(), &KConfigWatcher::configChanged,
+        [this](const KConfigGroup &group) {
+            if (group.name() == QLatin1String("Shortcuts")) {
+                m_built = false;
+            }
+        });
+    }
+
+    KStandardShortcut::StandardShortcut shortcut(int key, bool findReplaceEnabled)
+    {
+        if (!m_built) {
+            build();
+        }
+        return (findReplaceEnabled ? m_withFind : m_withoutFind).value(key, KStandardShortcut::AccelNone);
+    }
+
+private:
+    void build()
+    {
+        // KStandardShortcut reads the configuration only once, changes of
+        // other processes are only found in the configuration itself.
+        const KConfigGroup group(KSharedConfig::openConfig(), "Shortcuts");
+
+        // The find actions can be disabled, so there are tables with and
+        // without them.
+        m_withFind.clear();
+        m_withoutFind.clear();
+        for (const KStandardShortcut::StandardShortcut id : s_handledShortcuts) {
+            const bool isFind = id == KStandardShortcut::Find || id == KStandardShortcut::FindNext
+                                || id == KStandardShortcut::FindPrev || id == KStandardShortcut::Replace;
+            const QString name = KStandardShortcut::name(id);
+            QList<QKeySequence> sequences;
+            if (!group.hasKey(name)) {
+                sequences = KStandardShortcut::hardcodedDefaultShortcut(id);
+            } else {
+                const QString entry = group.readEntry(name, QString());
+                if (entry != QLatin1String("none")) {
+                    sequences = QKeySequence::listFromString(entry);
+                }
+            }
+            for (const QKeySequence &sequence : qAsConst(sequences)) {
+                if (sequence.count() != 1) {
+                    continue;
+                }
+                if (!m_withFind.contains(sequence[0])) {
+                    m_withFind.insert(sequence[0], id);
+                }
+                if (!isFind && !m_withoutFind.contains(sequence[0])) {
+                    m_withoutFind.insert(sequence[0], id);
+                }
+            }
+        }
+        m_built = true;
+    }
+
+    KConfigWatcher::Ptr m_watcher;
+    QHash<int, KStandardShortcut::StandardShortcut> m_withFind;
+    QHash<int, KStandardShortcut::StandardShortcut> m_withoutFind;
+    bool m_built;
+};
+
+Q_GLOBAL_STATIC(KTextEditShortcuts, s_textEditShortcuts)
+
 class Q_DECL_HIDDEN KTextEdit::Private
 {
 public:
@@ -72,12 +180,26 @@ public:
           findReplaceEnabled(true),
           showTabAction(true),
           showAutoCorrectionButton(false),
+          viewportSpellChecking(false),
+          threadedSpellChecking(false),
+          spellCheckEdited(false),
+          spellCheckRunning(false),
+          spellCheckWasReadOnly(false),
+          spellCheckSkipRegions(KTextEdit::SkipNothing),
           decorator(nullptr), speller(nullptr), findDlg(nullptr), find(nullptr), repDlg(nullptr), replace(nullptr),
 #ifdef HAVE_SPEECH
           textToSpeech(nullptr),
 #endif
           findIndex(0), repIndex(0),
-          lastReplacedPosition(-1)
+          lastReplacedPosition(-1),
+          largeDocumentHelper(nullptr),
+          largeDocumentScrollBarPolicy(Qt::ScrollBarAsNeeded),
+          largeDocumentWasReadOnly(false),
+          snapshotBuilder(nullptr),
+          pasteChunkThreshold(0),
+          pasteOffset(0),
+          pasteWasReadOnly(false),
+          insertingPasteChunk(false)
     {
         //Check the default sonnet settings to see if spellchecking should be enabled.
         QSettings settings(QStringLiteral("KDE"), QStringLiteral("Sonnet"));
@@ -86,12 +208,17 @@ public:
 
     ~Private()
     {
+        if (spellCheckDialog) {
+            QObject::disconnect(spellCheckDialog, nullptr, parent, nullptr);
+        }
         delete decorator;
         delete findDlg;
         delete find;
         delete replace;
         delete repDlg;
         delete speller;
+        delete largeDocumentHelper;
+        delete snapshotBuilder;
 #ifdef HAVE_SPEECH
         delete textToSpeech;
 #endif
@@ -108,6 +235,22 @@ public:
      */
     bool handleShortcut(const QKeyEvent *e);
 
+    /**
+     * Moves the cursor one viewport height down or up and scrolls along,
+     * like Page Down and Page Up.
+     */
+    void moveCursorByPage(bool down);
+    void leaveLargeDocumentMode();
+
+    /**
+     * Starts inserting @p text in chunks at the cursor, if it is longer
+     * than the chunked paste threshold. Returns false if it is not.
+     */
+    bool pasteInChunks(const QString &text);
+    void insertNextPasteChunk();
+    void stopChunkedPaste(bool canceled);
+    void interruptChunkedPaste(int position, int charsAdded);
+
     void spellCheckerMisspelling(const QString &text, int pos);
     void spellCheckerCorrected(const QString &, int, const QString &);
     void spellCheckerAutoCorrect(const QString &, const QString &);
@@ -130,6 +273,9 @@ public:
     void init();
 
     void checkSpelling(bool force);
+    QString nextSpellCheckChunk(const QTextBlock &firstBlock);
+    void spellCheckerChunkDone(Sonnet::Dialog *spellDialog, bool force);
+    void endSpellCheck();
     KTextEdit *parent;
     QAction *autoSpellCheckAction;
     QAction *allowTab;
@@ -141,8 +287,17 @@ public:
     bool findReplaceEnabled: 1;
     bool showTabAction: 1;
     bool showAutoCorrectionButton: 1;
+    bool viewportSpellChecking: 1;
+    bool threadedSpellChecking: 1;
+    bool spellCheckEdited: 1;
+    bool spellCheckRunning: 1;
+    bool spellCheckWasReadOnly: 1;
+    QPointer<Sonnet::Dialog> spellCheckDialog;
     QTextDocumentFragment originalDoc;
+    QTextCursor spellCheckChunkStart;
+    QTextCursor spellCheckChunkEnd;
     QString spellCheckingLanguage;
+    KTextEdit::SpellCheckSkipRegions spellCheckSkipRegions;
     Sonnet::SpellCheckDecorator *decorator;
     Sonnet::Speller *speller;
     KFindDialog *findDlg;
@@ -155,6 +310,26 @@ public:
 
     int findIndex, repIndex;
     int lastReplacedPosition;
+
+    LargeDocumentHelper *largeDocumentHelper;
+    Qt::ScrollBarPolicy largeDocumentScrollBarPolicy;
+    bool largeDocumentWasReadOnly;
+    QMetaObject::Connection largeDocumentConnection;
+
+    KTextEditSnapshotBuilder *snapshotBuilder;
+
+    int pasteChunkThreshold;
+    QString pasteText;
+    int pasteOffset;
+    // Inserts the chunks; pasteStart stays in front of the pasted text
+    QTextCursor pasteCursor;
+    QTextCursor pasteStart;
+    // The selection replaced by the paste
+    QTextDocumentFragment pasteReplaced;
+    QTimer pasteTimer;
+    QMetaObject::Connection pasteConnection;
+    bool pasteWasReadOnly;
+    bool insertingPasteChunk;
 };
 
 void KTextEdit::Private::checkSpelling(bool force)
@@ -166,6 +341,10 @@ void KTextEdit::Private::checkSpelling(bool force)
         }
         return;
     }
+    if (spellCheckDialog) {
+        KWindowSystem::activateWindow(spellCheckDialog->winId());
+        return;
+    }
     Sonnet::BackgroundChecker *backgroundSpellCheck = new Sonnet::BackgroundChecker;
     if (!spellCheckingLanguage.isEmpty()) {
         backgroundSpellCheck->changeLanguage(spellCheckingLanguage);
@@ -181,8 +360,9 @@ void KTextEdit::Private::checkSpelling(bool force)
             parent, SLOT(spellCheckerMisspelling(QString,int)));
     connect(spellDialog, &Sonnet::Dialog::autoCorrect,
             parent, &KTextEdit::spellCheckerAutoCorrect);
-    connect(spellDialog, SIGNAL(done(QString)),
-            parent, SLOT(spellCheckerFinished()));
+    connect(spellDialog, &Sonnet::Dialog::done, parent, [this, spellDialog, force]() {
+        spellCheckerChunkDone(spellDialog, force);
+    });
     connect(spellDialog, SIGNAL(cancel()),
             parent, SLOT(spellCheckerCanceled()));
     //Laurent in sonnet/dialog.cpp we emit done(QString) too => it calls here twice spellCheckerFinished not necessary
@@ -195,22 +375,96 @@ void KTextEdit::Private::checkSpelling(bool force)
     connect(spellDialog, &Sonnet::Dialog::languageChanged,
             parent, &KTextEdit::languageChanged);
     if (force) {
-        connect(spellDialog, SIGNAL(done(QString)), parent, SIGNAL(spellCheckingFinished()));
         connect(spellDialog, &Sonnet::Dialog::cancel, parent, &KTextEdit::spellCheckingCanceled);
         //Laurent in sonnet/dialog.cpp we emit done(QString) too => it calls here twice spellCheckerFinished not necessary
         //connect(spellDialog, SIGNAL(stop()), parent, SIGNAL(spellCheckingFinished()));
     }
-    originalDoc = QTextDocumentFragment(parent->document());
-    spellDialog->setBuffer(parent->toPlainText());
+
+    // Corrections are recorded as one undo step, which is undone on cancel.
+    // Only without undo stack the whole document has to be saved for that.
+    QTextDocument *doc = parent->document();
+    spellCheckEdited = false;
+    originalDoc = doc->isUndoRedoEnabled() ? QTextDocumentFragment() : QTextDocumentFragment(doc);
+
+    // Typing while the dialog is open would be merged into the undo step of
+    // the corrections, which is undone on cancel.
+    spellCheckDialog = spellDialog;
+    spellCheckRunning = true;
+    spellCheckWasReadOnly = parent->isReadOnly();
+    parent->QTextEdit::setReadOnly(true);
+    connect(spellDialog, &QObject::destroyed, parent, [this]() {
+        endSpellCheck();
+    });
+
+    spellDialog->setBuffer(nextSpellCheckChunk(doc->begin()));
     spellDialog->show();
 }
 
+void KTextEdit::Private::endSpellCheck()
+{
+    if (spellCheckRunning) {
+        spellCheckRunning = false;
+        parent->QTextEdit::setReadOnly(spellCheckWasReadOnly);
+    }
+}
+
+// Blocks given to the spell check dialog at once
+static const int s_spellCheckChunkSize = 4096;
+
+QString KTextEdit::Private::nextSpellCheckChunk(const QTextBlock &firstBlock)
+{
+    QString chunk;
+    QTextBlock lastBlock = firstBlock;
+    for (QTextBlock block = firstBlock; block.isValid(); block = block.next()) {
+        if (block != firstBlock) {
+            if (chunk.size() + block.length() > s_spellCheckChunkSize) {
+                break;
+            }
+            chunk += QLatin1Char('\n');
+        }
+        chunk += block.text();
+        lastBlock = block;
+    }
+
+    // The cursors follow the chunk through the corrections.
+    spellCheckChunkStart = QTextCursor(firstBlock);
+    spellCheckChunkStart.setKeepPositionOnInsert(true);
+    spellCheckChunkEnd = QTextCursor(lastBlock);
+    spellCheckChunkEnd.movePosition(QTextCursor::EndOfBlock);
+    return chunk;
+}
+
+void KTextEdit::Private::spellCheckerChunkDone(Sonnet::Dialog *spellDialog, bool force)
+{
+    // Setting a new buffer while the dialog reports done makes it continue.
+    for (QTextBlock block = spellCheckChunkEnd.block().next(); block.isValid();
+            block = spellCheckChunkEnd.block().next()) {
+        const QString chunk = nextSpellCheckChunk(block);
+        if (!chunk.trimmed().isEmpty()) {
+            spellDialog->setBuffer(chunk);
+            return;
+        }
+    }
+
+    spellCheckerFinished();
+    if (force) {
+        emit parent->spellCheckingFinished();
+    }
+}
+
 void KTextEdit::Private::spellCheckerCanceled()
 {
     QTextDocument *doc = parent->document();
-    doc->clear();
-    QTextCursor cursor(doc);
-    cursor.insertFragment(originalDoc);
+    if (spellCheckEdited) {
+        if (doc->isUndoRedoEnabled()) {
+            doc->undo();
+        } else {
+            doc->clear();
+            QTextCursor cursor(doc);
+            cursor.insertFragment(originalDoc);
+        }
+    }
+    originalDoc = QTextDocumentFragment();
     spellCheckerFinished();
 }
 
@@ -222,25 +476,42 @@ void KTextEdit::Private::spellCheckerAutoCorrect(const QString &currentWord, con
 void KTextEdit::Private::spellCheckerMisspelling(const QString &text, int pos)
 {
     //qDebug()<<"TextEdit::Private::spellCheckerMisspelling :"<<text<<" pos :"<<pos;
-    parent->highlightWord(text.length(), pos);
+    parent->highlightWord(text.length(), spellCheckChunkStart.position() + pos);
 }
 
 void KTextEdit::Private::spellCheckerCorrected(const QString &oldWord, int pos, const QString &newWord)
 {
     //qDebug()<<" oldWord :"<<oldWord<<" newWord :"<<newWord<<" pos : "<<pos;
     if (oldWord != newWord) {
+        const int start = spellCheckChunkStart.position() + pos;
         QTextCursor cursor(parent->document());
-        cursor.setPosition(pos);
-        cursor.setPosition(pos + oldWord.length(), QTextCursor::KeepAnchor);
+        cursor.setPosition(start);
+        cursor.setPosition(start + oldWord.length(), QTextCursor::KeepAnchor);
+        if (spellCheckEdited) {
+            cursor.joinPreviousEditBlock();
+        } else {
+            cursor.beginEditBlock();
+        }
         cursor.insertText(newWord);
+        cursor.endEditBlock();
+        spellCheckEdited = true;
     }
 }
 
 void KTextEdit::Private::spellCheckerFinished()
 {
+    endSpellCheck();
+
+    // Words may have been added to the personal dictionary.
+    SpellCheckCache::instance()->clear();
+
     QTextCursor cursor(parent->document());
     cursor.clearSelection();
     parent->setTextCursor(cursor);
+    KTextEditHighlighter *spellHighlighter = dynamic_cast<KTextEditHighlighter *>(parent->highlighter());
+    if (spellHighlighter) {
+        spellHighlighter->invalidateResults();
+    }
     if (parent->highlighter()) {
         parent->highlighter()->rehighlight();
     }
@@ -308,6 +579,149 @@ void KTextEdit::Private::init()
     KCursor::setAutoHideCursor(parent, true, false);
     parent->connect(parent, &KTextEdit::languageChanged,
                     parent, &KTextEdit::setSpellCheckingLanguage);
+
+    pasteTimer.setInterval(0);
+    parent->connect(&pasteTimer, &QTimer::timeout, parent, [this]() {
+        insertNextPasteChunk();
+    });
+}
+
+// Pasted text is inserted in chunks of about this many characters
+static const int s_pasteChunkSize = 64 * 1024;
+
+bool KTextEdit::Private::pasteInChunks(const QString &text)
+{
+    if (pasteChunkThreshold <= 0 || text.size() <= pasteChunkThreshold) {
+        return false;
+    }
+
+    // A new paste goes after the previous one
+    while (pasteTimer.isActive()) {
+        insertNextPasteChunk();
+    }
+
+    pasteText = text;
+    pasteOffset = 0;
+    pasteCursor = parent->textCursor();
+    pasteStart = QTextCursor(parent->document());
+    pasteStart.setPosition(pasteCursor.selectionStart());
+    pasteStart.setKeepPositionOnInsert(true);
+    pasteReplaced = QTextDocumentFragment(pasteCursor);
+
+    // The user should not interfere until the paste is done. The
+    // highlighter stays attached and checks each chunk as it is inserted,
+    // instead of all of the text at once afterwards.
+    pasteWasReadOnly = parent->isReadOnly();
+    parent->QTextEdit::setReadOnly(true);
+    pasteConnection = QObject::connect(parent->document(), &QTextDocument::contentsChange, parent,
+    [this](int position, int charsRemoved, int charsAdded) {
+        // Changes of the formatting only, as by auto linking or the
+        // highlighter, leave the pasted text alone
+        if (!insertingPasteChunk && charsRemoved != charsAdded) {
+            interruptChunkedPaste(position, charsAdded);
+        }
+    });
+
+    pasteTimer.start();
+    insertNextPasteChunk();
+    return true;
+}
+
+void KTextEdit::Private::insertNextPasteChunk()
+{
+    if (pasteCursor.isNull() || pasteCursor.document() != parent->document()) {
+        stopChunkedPaste(true);
+        return;
+    }
+
+    const int size = pasteText.size();
+    int end = qMin(size, pasteOffset + s_pasteChunkSize);
+    if (end < size) {
+        // Preferably end after a line break, and never split a surrogate
+        // pair or a CR LF pair.
+        const int lineEnd = pasteText.lastIndexOf(QLatin1Char('\n'), end - 1);
+        if (lineEnd >= pasteOffset) {
+            end = lineEnd + 1;
+        } else if (pasteText.at(end - 1).isHighSurrogate()
+                   || (pasteText.at(end - 1) == QLatin1Char('\r') && pasteText.at(end) == QLatin1Char('\n'))) {
+            ++end;
+        }
+    }
+
+    insertingPasteChunk = true;
+    if (pasteOffset == 0) {
+        pasteCursor.beginEditBlock();
+        pasteCursor.removeSelectedText();
+    } else {
+        pasteCursor.joinPreviousEditBlock();
+    }
+    pasteCursor.insertText(pasteText.mid(pasteOffset, end - pasteOffset));
+    pasteCursor.endEditBlock();
+    insertingPasteChunk = false;
+
+    pasteOffset = end;
+    emit parent->chunkedPasteProgress(pasteOffset, size);
+    if (pasteOffset >= size) {
+        stopChunkedPaste(false);
+    }
+}
+
+void KTextEdit::Private::stopChunkedPaste(bool canceled)
+{
+    if (!pasteTimer.isActive()) {
+        return;
+    }
+    pasteTimer.stop();
+    QObject::disconnect(pasteConnection);
+
+    parent->QTextEdit::setReadOnly(pasteWasReadOnly);
+    if (!canceled) {
+        parent->setTextCursor(pasteCursor);
+        parent->ensureCursorVisible();
+    }
+    pasteText = QString();
+    pasteCursor = QTextCursor();
+    pasteStart = QTextCursor();
+    pasteReplaced = QTextDocumentFragment();
+
+    emit parent->chunkedPasteFinished(canceled);
+}
+
+// Cancels a chunked paste after another change of the text, which cannot be
+// undone separately anymore. The pasted text is replaced by the selection it
+// replaced once the change is done.
+void KTextEdit::Private::interruptChunkedPaste(int position, int charsAdded)
+{
+    // The text added by the change is not part of the paste, even where it
+    // touches or replaces the start or the end of the pasted text
+    int start = pasteStart.position();
+    if (start == position) {
+        start += charsAdded;
+    }
+    int end = pasteCursor.position();
+    if (end == position + charsAdded) {
+        end = position;
+    }
+    QTextCursor pasted;
+    if (start < end) {
+        pasted = QTextCursor(parent->document());
+        pasted.setPosition(start);
+        pasted.setPosition(end, QTextCursor::KeepAnchor);
+    }
+    const QTextDocumentFragment replaced = pasteReplaced;
+    stopChunkedPaste(true);
+
+    if (!pasted.isNull()) {
+        // The other receivers of contentsChange() do not expect the text to
+        // change again before they are called
+        QMetaObject::invokeMethod(parent, [pasted, replaced]() mutable {
+            if (replaced.isEmpty()) {
+                pasted.removeSelectedText();
+            } else {
+                pasted.insertFragment(replaced);
+            }
+        }, Qt::QueuedConnection);
+    }
 }
 
 KTextDecorator::KTextDecorator(KTextEdit *textEdit):
@@ -321,6 +735,45 @@ bool KTextDecorator::isSpellCheckingEnabledForBlock(const QString &textBlock) co
     return m_textEdit->shouldBlockBeSpellChecked(textBlock);
 }
 
+bool KTextDecorator::eventFilter(QObject *watched, QEvent *event)
+{
+    QPointer<KTextEditHighlighter> spellHighlighter = dynamic_cast<KTextEditHighlighter *>(highlighter());
+    if (event->type() != QEvent::ContextMenu || !spellHighlighter) {
+        return Sonnet::SpellCheckDecorator::eventFilter(watched, event);
+    }
+
+    // The suggestion menu calls Sonnet::Highlighter::ignoreWord() or
+    // addWordToDictionary(), which are not virtual. So the words it may
+    // offer, the clicked one with and without apostrophes around it and
+    // the selection, are compared before and after it.
+    QTextCursor cursor = m_textEdit->cursorForPosition(static_cast<QContextMenuEvent *>(event)->pos());
+    cursor.select(QTextCursor::WordUnderCursor);
+    QString word = cursor.selectedText();
+    QStringList candidates = {word};
+    while (word.startsWith(QLatin1Char('\''))) {
+        word.remove(0, 1);
+    }
+    while (word.endsWith(QLatin1Char('\''))) {
+        word.chop(1);
+    }
+    candidates << word << m_textEdit->textCursor().selectedText();
+    QStringList misspelled;
+    for (const QString &candidate : qAsConst(candidates)) {
+        if (!candidate.isEmpty() && !misspelled.contains(candidate)
+                && spellHighlighter->isWordMisspelled(candidate)) {
+            misspelled.append(candidate);
+        }
+    }
+
+    const bool filtered = Sonnet::SpellCheckDecorator::eventFilter(watched, event);
+    for (const QString &candidate : qAsConst(misspelled)) {
+        if (spellHighlighter && !spellHighlighter->isWordMisspelled(candidate)) {
+            spellHighlighter->acceptWord(candidate);
+        }
+    }
+    return filtered;
+}
+
 KTextEdit::KTextEdit(const QString &text, QWidget *parent)
     : QTextEdit(text, parent), d(new Private(this))
 {
@@ -382,127 +835,134 @@ bool KTextEdit::event(QEvent *ev)
     return QTextEdit::event(ev);
 }
 
+void KTextEdit::Private::moveCursorByPage(bool down)
+{
+    // A single hit test one page away, instead of moving line by line,
+    // keeps paging fast with long wrapped paragraphs.
+    const QRect cursorRect = parent->cursorRect();
+    const int pageHeight = parent->viewport()->height();
+    const int scrollOffset = parent->verticalScrollBar()->value();
+    const QTextDocument *doc = parent->document();
+    const qreal documentHeight = doc->documentLayout()->documentSize().height();
+    const qreal margin = doc->documentMargin();
+
+    int y = cursorRect.center().y() + (down ? pageHeight : -pageHeight);
+    // Beyond the text, only move to the first or last line, without scrolling.
+    const bool beyondText = down ? y + scrollOffset >= documentHeight - margin
+                                 : y + scrollOffset < margin;
+    if (beyondText) {
+        y = down ? int(documentHeight - margin) - 1 - scrollOffset
+                 : int(margin) + 1 - scrollOffset;
+    }
+
+    const QTextCursor cursor = parent->cursorForPosition(QPoint(cursorRect.center().x(), y));
+    if (!beyondText) {
+        parent->verticalScrollBar()->triggerAction(down ? QAbstractSlider::SliderPageStepAdd
+                                                        : QAbstractSlider::SliderPageStepSub);
+    }
+    parent->setTextCursor(cursor);
+}
+
 bool KTextEdit::Private::handleShortcut(const QKeyEvent *event)
 {
     const int key = event->key() | event->modifiers();
 
-    if (KStandardShortcut::copy().contains(key)) {
+    switch (s_textEditShortcuts()->shortcut(key, findReplaceEnabled)) {
+    case KStandardShortcut::Copy:
         parent->copy();
         return true;
-    } else if (KStandardShortcut::paste().contains(key)) {
+    case KStandardShortcut::Paste:
         parent->paste();
         return true;
-    } else if (KStandardShortcut::cut().contains(key)) {
+    case KStandardShortcut::Cut:
         parent->cut();
         return true;
-    } else if (KStandardShortcut::undo().contains(key)) {
+    case KStandardShortcut::Undo:
         if (!parent->isReadOnly()) {
             parent->undo();
         }
         return true;
-    } else if (KStandardShortcut::redo().contains(key)) {
+    case KStandardShortcut::Redo:
         if (!parent->isReadOnly()) {
             parent->redo();
         }
         return true;
-    } else if (KStandardShortcut::deleteWordBack().contains(key)) {
+    case KStandardShortcut::DeleteWordBack:
         if (!parent->isReadOnly()) {
-           parent->deleteWordBack();
+            parent->deleteWordBack();
         }
         return true;
-    } else if (KStandardShortcut::deleteWordForward().contains(key)) {
+    case KStandardShortcut::DeleteWordForward:
         if (!parent->isReadOnly()) {
             parent->deleteWordForward();
         }
         return true;
-    } else if (KStandardShortcut::backwardWord().contains(key)) {
+    case KStandardShortcut::BackwardWord: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::PreviousWord);
         parent->setTextCursor(cursor);
         return true;
-    } else if (KStandardShortcut::forwardWord().contains(key)) {
+    }
+    case KStandardShortcut::ForwardWord: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::NextWord);
         parent->setTextCursor(cursor);
         return true;
-    } else if (KStandardShortcut::next().contains(key)) {
-        QTextCursor cursor = parent->textCursor();
-        bool moved = false;
-        qreal lastY = parent->cursorRect(cursor).bottom();
-        qreal distance = 0;
-        do {
-            qreal y = parent->cursorRect(cursor).bottom();
-            distance += qAbs(y - lastY);
-            lastY = y;
-            moved = cursor.movePosition(QTextCursor::Down);
-        } while (moved && distance < parent->viewport()->height());
-
-        if (moved) {
-            cursor.movePosition(QTextCursor::Up);
-            parent->verticalScrollBar()->triggerAction(QAbstractSlider::SliderPageStepAdd);
-        }
-        parent->setTextCursor(cursor);
+    }
+    case KStandardShortcut::Next:
+        moveCursorByPage(true);
         return true;
-    } else if (KStandardShortcut::prior().contains(key)) {
-        QTextCursor cursor = parent->textCursor();
-        bool moved = false;
-        qreal lastY = parent->cursorRect(cursor).bottom();
-        qreal distance = 0;
-        do {
-            qreal y = parent->cursorRect(cursor).bottom();
-            distance += qAbs(y - lastY);
-            lastY = y;
-            moved = cursor.movePosition(QTextCursor::Up);
-        } while (moved && distance < parent->viewport()->height());
-
-        if (moved) {
-            cursor.movePosition(QTextCursor::Down);
-            parent->verticalScrollBar()->triggerAction(QAbstractSlider::SliderPageStepSub);
-        }
-        parent->setTextCursor(cursor);
+    case KStandardShortcut::Prior:
+        moveCursorByPage(false);
         return true;
-    } else if (KStandardShortcut::begin().contains(key)) {
+    case KStandardShortcut::Begin: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::Start);
         parent->setTextCursor(cursor);
         return true;
-    } else if (KStandardShortcut::end().contains(key)) {
+    }
+    case KStandardShortcut::End: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::End);
         parent->setTextCursor(cursor);
         return true;
-    } else if (KStandardShortcut::beginningOfLine().contains(key)) {
+    }
+    case KStandardShortcut::BeginningOfLine: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::StartOfLine);
         parent->setTextCursor(cursor);
         return true;
-    } else if (KStandardShortcut::endOfLine().contains(key)) {
+    }
+    case KStandardShortcut::EndOfLine: {
         QTextCursor cursor = parent->textCursor();
         cursor.movePosition(QTextCursor::EndOfLine);
         parent->setTextCursor(cursor);
         return true;
-    } else if (findReplaceEnabled && KStandardShortcut::find().contains(key)) {
+    }
+    case KStandardShortcut::Find:
         parent->slotFind();
         return true;
-    } else if (findReplaceEnabled && KStandardShortcut::findNext().contains(key)) {
+    case KStandardShortcut::FindNext:
         parent->slotFindNext();
         return true;
-    } else if (findReplaceEnabled && KStandardShortcut::findPrev().contains(key)) {
+    case KStandardShortcut::FindPrev:
         parent->slotFindPrevious();
         return true;
-    } else if (findReplaceEnabled && KStandardShortcut::replace().contains(key)) {
+    case KStandardShortcut::Replace:
         if (!parent->isReadOnly()) {
             parent->slotReplace();
         }
         return true;
-    } else if (KStandardShortcut::pasteSelection().contains(key)) {
+    case KStandardShortcut::PasteSelection: {
         QString text = QApplication::clipboard()->text(QClipboard::Selection);
-        if (!text.isEmpty()) {
+        if (!text.isEmpty() && !pasteInChunks(text)) {
             parent->insertPlainText(text);    // TODO: check if this is html? (MiB)
         }
         return true;
     }
-    return false;
+    default:
+        return false;
+    }
 }
 
 static void deleteWord(QTextCursor cursor, QTextCursor::MoveOperation op)
@@ -651,6 +1111,59 @@ void KTextEdit::slotSpeakText()
 #endif
 }
 
+void KTextEdit::insertFromMimeData(const QMimeData *source)
+{
+    if (d->pasteChunkThreshold > 0 && source->hasText() && !(acceptRichText() && source->hasHtml())
+            && d->pasteInChunks(source->text())) {
+        return;
+    }
+    QTextEdit::insertFromMimeData(source);
+}
+
+void KTextEdit::setChunkedPasteThreshold(int characters)
+{
+    d->pasteChunkThreshold = qMax(0, characters);
+}
+
+int KTextEdit::chunkedPasteThreshold() const
+{
+    return d->pasteChunkThreshold;
+}
+
+bool KTextEdit::isChunkedPasteActive() const
+{
+    return d->pasteTimer.isActive();
+}
+
+void KTextEdit::cancelChunkedPaste()
+{
+    if (!d->pasteTimer.isActive()) {
+        return;
+    }
+    if (d->pasteOffset > 0 && !d->pasteCursor.isNull()) {
+        // Undoing also restores a selection replaced by the paste
+        d->insertingPasteChunk = true;
+        if (document()->isUndoRedoEnabled()) {
+            document()->undo();
+        } else {
+            QTextCursor cursor = d->pasteStart;
+            cursor.setPosition(d->pasteCursor.position(), QTextCursor::KeepAnchor);
+            cursor.removeSelectedText();
+        }
+        d->insertingPasteChunk = false;
+    }
+    d->stopChunkedPaste(true);
+}
+
+QMimeData *KTextEdit::createMimeDataFromSelection() const
+{
+    const QTextCursor cursor = textCursor();
+    if (!cursor.hasSelection()) {
+        return QTextEdit::createMimeDataFromSelection();
+    }
+    return new KTextEditMimeData(cursor, acceptRichText());
+}
+
 void KTextEdit::contextMenuEvent(QContextMenuEvent *event)
 {
     QMenu *popup = mousePopupMenu();
@@ -663,7 +1176,11 @@ void KTextEdit::contextMenuEvent(QContextMenuEvent *event)
 
 void KTextEdit::createHighlighter()
 {
-    setHighlighter(new Sonnet::Highlighter(this));
+    KTextEditHighlighter *spellHighlighter = new KTextEditHighlighter(this);
+    spellHighlighter->setViewportOnly(d->viewportSpellChecking);
+    spellHighlighter->setThreaded(d->threadedSpellChecking);
+    spellHighlighter->setSkipRegions(d->spellCheckSkipRegions);
+    setHighlighter(spellHighlighter);
 }
 
 Sonnet::Highlighter *KTextEdit::highlighter() const
@@ -737,6 +1254,63 @@ bool KTextEdit::checkSpellingEnabled() const
     return d->spellCheckingEnabled;
 }
 
+void KTextEdit::setSpellCheckingRestrictedToViewport(bool restricted)
+{
+    d->viewportSpellChecking = restricted;
+    KTextEditHighlighter *spellHighlighter = dynamic_cast<KTextEditHighlighter *>(highlighter());
+    if (spellHighlighter) {
+        spellHighlighter->setViewportOnly(restricted);
+    }
+}
+
+bool KTextEdit::isSpellCheckingRestrictedToViewport() const
+{
+    return d->viewportSpellChecking;
+}
+
+void KTextEdit::setThreadedSpellCheckingEnabled(bool threaded)
+{
+    d->threadedSpellChecking = threaded;
+    KTextEditHighlighter *spellHighlighter = dynamic_cast<KTextEditHighlighter *>(highlighter());
+    if (spellHighlighter) {
+        spellHighlighter->setThreaded(threaded);
+    }
+}
+
+bool KTextEdit::isThreadedSpellCheckingEnabled() const
+{
+    return d->threadedSpellChecking;
+}
+
+void KTextEdit::setSpellCheckSkipRegions(SpellCheckSkipRegions regions)
+{
+    d->spellCheckSkipRegions = regions;
+    KTextEditHighlighter *spellHighlighter = dynamic_cast<KTextEditHighlighter *>(highlighter());
+    if (spellHighlighter) {
+        spellHighlighter->setSkipRegions(regions);
+    }
+}
+
+KTextEdit::SpellCheckSkipRegions KTextEdit::spellCheckSkipRegions() const
+{
+    return d->spellCheckSkipRegions;
+}
+
+KTextEdit::SpellCheckCacheStatistics KTextEdit::spellCheckCacheStatistics()
+{
+    const SpellCheckCache *cache = SpellCheckCache::instance();
+    SpellCheckCacheStatistics statistics;
+    statistics.hits = cache->hits();
+    statistics.misses = cache->misses();
+    statistics.words = cache->count();
+    return statistics;
+}
+
+void KTextEdit::clearSpellCheckCache()
+{
+    SpellCheckCache::instance()->clear();
+}
+
 bool KTextEdit::shouldBlockBeSpellChecked(const QString &) const
 {
     return true;
@@ -787,6 +1361,199 @@ void KTextEdit::forceSpellChecking()
     d->checkSpelling(true);
 }
 
+void KTextEdit::adoptDocument(QTextDocument *document)
+{
+    QTextDocument *oldDocument = this->document();
+    if (!document || document == oldDocument) {
+        return;
+    }
+    Q_ASSERT(document->thread() == thread());
+
+    d->leaveLargeDocumentMode();
+    document->setParent(this);
+    document->setDefaultFont(oldDocument->defaultFont());
+    document->setDocumentMargin(oldDocument->documentMargin());
+    document->setIndentWidth(oldDocument->indentWidth());
+    document->setUseDesignMetrics(oldDocument->useDesignMetrics());
+
+    Sonnet::Highlighter *spellHighlighter = highlighter();
+    viewport()->setUpdatesEnabled(false);
+    // The document created by QTextEdit itself is deleted by setDocument(),
+    // one adopted earlier is owned by us. Check before it may be gone.
+    const bool ownedByUs = oldDocument->parent() == this;
+    setDocument(document);
+    if (ownedByUs) {
+        delete oldDocument;
+    }
+    if (spellHighlighter) {
+        spellHighlighter->setDocument(document);
+    }
+    viewport()->setUpdatesEnabled(true);
+    viewport()->update();
+}
+
+void KTextEdit::Private::leaveLargeDocumentMode()
+{
+    if (!largeDocumentHelper) {
+        return;
+    }
+    QObject::disconnect(largeDocumentConnection);
+    delete largeDocumentHelper;
+    largeDocumentHelper = nullptr;
+    parent->setViewportMargins(0, 0, 0, 0);
+    parent->setVerticalScrollBarPolicy(largeDocumentScrollBarPolicy);
+    parent->setReadOnly(largeDocumentWasReadOnly);
+}
+
+void KTextEdit::setLargePlainText(const QByteArray &text)
+{
+    if (text.isEmpty()) {
+        d->leaveLargeDocumentMode();
+        clear();
+        return;
+    }
+
+    if (!d->largeDocumentHelper) {
+        d->largeDocumentScrollBarPolicy = verticalScrollBarPolicy();
+        d->largeDocumentWasReadOnly = isReadOnly();
+        // The own scroll bar only covers the loaded lines, the helper
+        // provides one for the whole text.
+        setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setReadOnly(true);
+        d->largeDocumentHelper = new LargeDocumentHelper(this);
+        // Text set by other means, like setPlainText(), would be replaced
+        // by the next window of the large text otherwise.
+        d->largeDocumentConnection = connect(document(), &QTextDocument::contentsChange, this, [this]() {
+            if (d->largeDocumentHelper && !d->largeDocumentHelper->isLoading()) {
+                d->leaveLargeDocumentMode();
+            }
+        });
+        const int width = d->largeDocumentHelper->scrollBar()->sizeHint().width();
+        if (isRightToLeft()) {
+            setViewportMargins(width, 0, 0, 0);
+        } else {
+            setViewportMargins(0, 0, width, 0);
+        }
+    }
+    d->largeDocumentHelper->setText(text);
+}
+
+bool KTextEdit::isLargeDocumentMode() const
+{
+    return d->largeDocumentHelper;
+}
+
+KTextEditSnapshot KTextEdit::snapshot() const
+{
+    if (!d->snapshotBuilder || d->snapshotBuilder->document() != document()) {
+        delete d->snapshotBuilder;
+        d->snapshotBuilder = new KTextEditSnapshotBuilder(document());
+    }
+    return d->snapshotBuilder->snapshot();
+}
+
+// With more inserted or removed lines than this, the changed lines are
+// replaced at once, which is as fast as applying many small edits.
+static const int s_maxTextDiffEdits = 2000;
+
+void KTextEdit::applyTextDiff(const QString &text)
+{
+    if (d->largeDocumentHelper) {
+        setLargePlainText(text.toUtf8());
+        return;
+    }
+
+    // Blocks have no line break characters, so all kinds of line breaks
+    // have to match the blocks.
+    QString normalizedText = text;
+    if (normalizedText.contains(QLatin1Char('\r'))) {
+        normalizedText.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        normalizedText.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    }
+
+    QTextDocument *doc = document();
+    const QVector<QStringRef> newLines = normalizedText.splitRef(QLatin1Char('\n'));
+    const int oldCount = doc->blockCount();
+    const int newCount = newLines.size();
+
+    // Only the lines between the common ones at the start and at the end
+    // are compared in detail.
+    int prefix = 0;
+    QTextBlock block = doc->begin();
+    while (prefix < oldCount && prefix < newCount && block.text() == newLines.at(prefix)) {
+        block = block.next();
+        ++prefix;
+    }
+    if (prefix == oldCount && prefix == newCount) {
+        return;
+    }
+    int suffix = 0;
+    QTextBlock lastBlock = doc->lastBlock();
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+            && lastBlock.text() == newLines.at(newCount - 1 - suffix)) {
+        lastBlock = lastBlock.previous();
+        ++suffix;
+    }
+
+    const int changedCount = oldCount - prefix - suffix;
+    QStringList oldTexts;
+    oldTexts.reserve(changedCount);
+    for (int i = 0; i < changedCount; ++i, block = block.next()) {
+        oldTexts.append(block.text());
+    }
+    QVector<QStringRef> oldLines;
+    oldLines.reserve(changedCount);
+    for (const QString &line : qAsConst(oldTexts)) {
+        oldLines.append(QStringRef(&line));
+    }
+    const QVector<LineDiff::Hunk> hunks =
+        LineDiff::compute(oldLines, newLines.mid(prefix, newCount - prefix - suffix), s_maxTextDiffEdits);
+
+    // Going backwards, the lines in front of each hunk keep their numbers
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    for (auto it = hunks.crbegin(); it != hunks.crend(); ++it) {
+        const int oldStart = prefix + it->oldStart;
+        const int newStart = prefix + it->newStart;
+        QString replacement;
+        for (int i = newStart; i < newStart + it->newCount; ++i) {
+            if (i > newStart) {
+                replacement += QLatin1Char('\n');
+            }
+            replacement += newLines.at(i);
+        }
+
+        if (it->oldCount > 0 && it->newCount > 0) {
+            const QTextBlock last = doc->findBlockByNumber(oldStart + it->oldCount - 1);
+            cursor.setPosition(doc->findBlockByNumber(oldStart).position());
+            cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+            cursor.insertText(replacement);
+        } else if (it->oldCount == 0) {
+            if (oldStart < oldCount) {
+                cursor.setPosition(doc->findBlockByNumber(oldStart).position());
+                cursor.insertText(replacement + QLatin1Char('\n'));
+            } else {
+                cursor.movePosition(QTextCursor::End);
+                cursor.insertText(QLatin1Char('\n') + replacement);
+            }
+        } else {
+            const int endLine = oldStart + it->oldCount;
+            if (endLine < oldCount) {
+                cursor.setPosition(doc->findBlockByNumber(oldStart).position());
+                cursor.setPosition(doc->findBlockByNumber(endLine).position(), QTextCursor::KeepAnchor);
+            } else if (oldStart > 0) {
+                const QTextBlock previous = doc->findBlockByNumber(oldStart - 1);
+                cursor.setPosition(previous.position() + previous.length() - 1);
+                cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+            } else {
+                cursor.select(QTextCursor::Document);
+            }
+            cursor.removeSelectedText();
+        }
+    }
+    cursor.endEditBlock();
+}
+
 void KTextEdit::highlightWord(int length, int pos)
 {
     QTextCursor cursor(document());
@@ -1004,45 +1771,7 @@ bool KTextEdit::Private::overrideShortcut(const QKeyEvent *event)
 {
     const int key = event->key() | event->modifiers();
 
-    if (KStandardShortcut::copy().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::paste().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::cut().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::undo().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::redo().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::deleteWordBack().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::deleteWordForward().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::backwardWord().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::forwardWord().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::next().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::prior().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::begin().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::end().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::beginningOfLine().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::endOfLine().contains(key)) {
-        return true;
-    } else if (KStandardShortcut::pasteSelection().contains(key)) {
-        return true;
-    } else if (findReplaceEnabled && KStandardShortcut::find().contains(key)) {
-        return true;
-    } else if (findReplaceEnabled && KStandardShortcut::findNext().contains(key)) {
-        return true;
-    } else if (findReplaceEnabled && KStandardShortcut::findPrev().contains(key)) {
-        return true;
-    } else if (findReplaceEnabled && KStandardShortcut::replace().contains(key)) {
+    if (s_textEditShortcuts()->shortcut(key, findReplaceEnabled) != KStandardShortcut::AccelNone) {
         return true;
     } else if (event->matches(QKeySequence::SelectAll)) { // currently missing in QTextEdit
         return true;
@@ -21,6 +21,7 @@
 #define KTEXTEDIT_H
 
 #include "ktextwidgets_export.h"
+#include "ktexteditsnapshot.h"
 
 #include <sonnet/highlighter.h>
 #include <QTextEdit>
@@ -58,6 +59,36 @@ class KTEXTWIDGETS_EXPORT KTextEdit : public QTextEdit //krazy:exclude=qclasses
     Q_PROPERTY(QString spellCheckingLanguage READ spellCheckingLanguage WRITE setSpellCheckingLanguage)
 
 public:
+    /**
+     * Parts of the text which are excluded from background spell checking.
+     *
+     * @see setSpellCheckSkipRegions()
+     * @since 5.65
+     */
+    enum SpellCheckSkipRegion {
+        /**
+         * Check all of the text
+         */
+        SkipNothing = 0x0,
+
+        /**
+         * Skip paragraphs starting with '>', as quoted in replies to mails
+         */
+        SkipQuotedLines = 0x1,
+
+        /**
+         * Skip URLs, like "https://kde.org" or "www.kde.org"
+         */
+        SkipUrls = 0x2,
+
+        /**
+         * Skip inline code, which is enclosed in backticks
+         */
+        SkipInlineCode = 0x4
+    };
+    Q_DECLARE_FLAGS(SpellCheckSkipRegions, SpellCheckSkipRegion)
+    Q_FLAG(SpellCheckSkipRegions)
+
     /**
      * Constructs a KTextEdit object. See QTextEdit::QTextEdit
      * for details.
@@ -103,6 +134,108 @@ public:
      */
     virtual bool checkSpellingEnabled() const;
 
+    /**
+     * Restricts background spell checking to the text visible in the viewport
+     * plus a margin of about one page above and below it. The rest of the
+     * text is checked when it is scrolled into view. This keeps inserting or
+     * loading large texts fast while spell checking is enabled.
+     *
+     * Only the default highlighter created by createHighlighter() supports
+     * this. By default the whole text is checked.
+     *
+     * @see isSpellCheckingRestrictedToViewport()
+     * @since 5.65
+     */
+    void setSpellCheckingRestrictedToViewport(bool restricted);
+
+    /**
+     * Returns true if background spell checking is restricted to the visible
+     * text.
+     *
+     * @see setSpellCheckingRestrictedToViewport()
+     * @since 5.65
+     */
+    bool isSpellCheckingRestrictedToViewport() const;
+
+    /**
+     * Moves background spell checking to a worker thread. The result of each
+     * paragraph is cached, so a paragraph is only checked again after its own
+     * text changed, and editing elsewhere never causes it to be rechecked.
+     * Misspelled words are underlined as soon as the results arrive.
+     *
+     * Only the default highlighter created by createHighlighter() supports
+     * this. By default spell checking runs in the GUI thread.
+     *
+     * @see isThreadedSpellCheckingEnabled()
+     * @since 5.65
+     */
+    void setThreadedSpellCheckingEnabled(bool threaded);
+
+    /**
+     * Returns true if background spell checking runs in a worker thread.
+     *
+     * @see setThreadedSpellCheckingEnabled()
+     * @since 5.65
+     */
+    bool isThreadedSpellCheckingEnabled() const;
+
+    /**
+     * Excludes parts of the text from background spell checking.
+     *
+     * The parts are found once per change of a paragraph and remembered with
+     * the paragraph, together with the result of shouldBlockBeSpellChecked(),
+     * so rehighlighting does not classify the text again.
+     *
+     * Only the default highlighter created by createHighlighter() supports
+     * this. While regions are skipped, the language of the text is not
+     * detected per sentence. By default all of the text is checked.
+     *
+     * @see spellCheckSkipRegions()
+     * @since 5.65
+     */
+    void setSpellCheckSkipRegions(SpellCheckSkipRegions regions);
+
+    /**
+     * Returns the parts of the text which are excluded from background spell
+     * checking.
+     *
+     * @see setSpellCheckSkipRegions()
+     * @since 5.65
+     */
+    SpellCheckSkipRegions spellCheckSkipRegions() const;
+
+    /**
+     * Statistics of the cache of spell checking results shared by all text
+     * edits of the process.
+     *
+     * @see spellCheckCacheStatistics()
+     * @since 5.65
+     */
+    struct SpellCheckCacheStatistics {
+        quint64 hits;   ///< Number of words answered from the cache
+        quint64 misses; ///< Number of words looked up in a dictionary
+        int words;      ///< Number of words currently cached
+    };
+
+    /**
+     * Returns the statistics of the process-wide cache of spell checking
+     * results. The cache is used by threaded spell checking, the hit rate
+     * is hits / (hits + misses).
+     *
+     * @see setThreadedSpellCheckingEnabled()
+     * @since 5.65
+     */
+    static SpellCheckCacheStatistics spellCheckCacheStatistics();
+
+    /**
+     * Removes all results from the process-wide cache of spell checking
+     * results. Call this after changing a personal dictionary outside of
+     * KTextEdit.
+     *
+     * @since 5.65
+     */
+    static void clearSpellCheckCache();
+
     /**
      * Returns true if the given paragraph or block should be spellcheck.
      * For example, a mail client does not want to check quoted text, and
@@ -224,6 +357,136 @@ public:
      */
     void forceSpellChecking();
 
+    /**
+     * Replaces the document of the text edit with @p document and takes
+     * ownership of it.
+     *
+     * This is the fastest way to show a large text: the document can be
+     * filled (with QTextDocument::setHtml() or setPlainText()) before it is
+     * shown, so that neither layouting nor spell checking nor any signal of the
+     * text edit runs for the intermediate states. It may even be filled in a
+     * worker thread; push it to the thread of the text edit with
+     * QObject::moveToThread() before calling this function.
+     *
+     * The default font, margin, indent width and metrics settings of the
+     * current document are carried over. The spell checking highlighter is
+     * moved to the new document. The undo history of the old document is lost,
+     * and the old document is deleted if the text edit owns it.
+     *
+     * @param document A document without parent, living in the thread of the
+     *                 text edit
+     * @since 5.65
+     */
+    void adoptDocument(QTextDocument *document);
+
+    /**
+     * Shows the UTF-8 encoded plain text @p text in large document mode,
+     * which is meant for viewing huge files such as logs and traces.
+     *
+     * Only the lines around the visible area are put into the document and
+     * laid out; the rest stays in @p text, which is not copied. Memory usage
+     * and loading time thus stay nearly independent of the size of the text.
+     * A memory mapped file can be shown with QByteArray::fromRawData(); the
+     * mapping has to outlive the text edit or the next call of this function.
+     *
+     * While in this mode, the text edit is read-only, the vertical scroll bar
+     * is estimated from the line count, and document() and toPlainText() only
+     * provide the lines currently loaded.
+     *
+     * Passing an empty array leaves large document mode and clears the text
+     * edit. Changing the text by other means, for example with
+     * setPlainText(), or adopting another document leaves the mode as well,
+     * keeping the new text.
+     *
+     * @see isLargeDocumentMode()
+     * @since 5.65
+     */
+    void setLargePlainText(const QByteArray &text);
+
+    /**
+     * @return true if the text edit shows a text set with setLargePlainText()
+     * @since 5.65
+     */
+    bool isLargeDocumentMode() const;
+
+    /**
+     * Replaces the text with the plain text @p text, changing only the lines
+     * which differ.
+     *
+     * The lines of the current text are compared with the lines of @p text,
+     * and only the inserted, removed or changed lines are edited, as a single
+     * undo step. Unlike with setPlainText(), the layout and spell checking of
+     * the other lines, the scroll position, the cursor and the undo history
+     * are kept. Apart from comparing the texts, the cost of the update
+     * depends on the size of the change rather than on the size of the text.
+     * The formatting of unchanged lines is kept as well.
+     *
+     * Lines may be separated by "\n", "\r\n" or "\r" in @p text.
+     *
+     * In large document mode, there is no diff: the whole text is replaced
+     * with setLargePlainText(), which also resets the scroll position and
+     * the cursor.
+     *
+     * @param text The new text
+     * @since 5.65
+     */
+    void applyTextDiff(const QString &text);
+
+    /**
+     * Returns an immutable copy of the plain text, which may be read from
+     * any thread.
+     *
+     * The first snapshot copies the whole text. Afterwards only the changed
+     * paragraphs are copied, the others are shared with the previous
+     * snapshot, so taking snapshots regularly, e.g. for autosaving or for
+     * searching in a worker thread, stays cheap even for large texts.
+     *
+     * In large document mode, only the currently loaded lines are copied.
+     *
+     * @see KTextEditSnapshot
+     * @since 5.65
+     */
+    KTextEditSnapshot snapshot() const;
+
+    /**
+     * Sets the number of characters above which pasted plain text is
+     * inserted in chunks.
+     *
+     * Such a paste inserts one chunk per iteration of the event loop, so the
+     * user interface stays responsive while the text is laid out and spell
+     * checked. Until it is finished, the text edit is read-only. The whole
+     * paste remains a single undo step. Progress is
+     * reported with chunkedPasteProgress(), the end with
+     * chunkedPasteFinished(), and cancelChunkedPaste() stops the paste.
+     * Changing the text by other means during the paste cancels it as well.
+     * Once that change is done, the pasted text is taken out again and a
+     * selection it replaced comes back. Changing only the formatting, for
+     * example by auto linking, does not cancel the paste.
+     *
+     * Rich text pastes are never chunked. The default of 0 disables chunked
+     * pasting.
+     *
+     * @param characters The threshold in characters, or 0 to disable it
+     * @see isChunkedPasteActive()
+     * @since 5.65
+     */
+    void setChunkedPasteThreshold(int characters);
+
+    /**
+     * @return the number of characters above which pasted plain text is
+     *         inserted in chunks, or 0 if it is always inserted at once.
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    int chunkedPasteThreshold() const;
+
+    /**
+     * @return true while pasted text is being inserted in chunks.
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    bool isChunkedPasteActive() const;
+
 Q_SIGNALS:
     /**
      * emit signal when we activate or not autospellchecking
@@ -279,6 +542,26 @@ Q_SIGNALS:
      */
     void spellCheckingCanceled();
 
+    /**
+     * Emitted after each chunk of a chunked paste was inserted.
+     *
+     * @param inserted The number of characters inserted so far
+     * @param total The number of characters of the pasted text
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    void chunkedPasteProgress(int inserted, int total);
+
+    /**
+     * Emitted when a chunked paste ends.
+     *
+     * @param canceled true if the paste was canceled with
+     *                 cancelChunkedPaste() or by changing the text in between
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    void chunkedPasteFinished(bool canceled);
+
 public Q_SLOTS:
 
     /**
@@ -294,6 +577,9 @@ public Q_SLOTS:
     /**
      * Show a dialog to check the spelling. The spellCheckStatus() signal
      * will be emitted when the spell checking dialog is closed.
+     *
+     * While the dialog is open, the text edit is read-only. If the dialog is
+     * already open, it is activated instead.
      */
     void checkSpelling();
 
@@ -330,6 +616,15 @@ public Q_SLOTS:
      */
     void clearDecorator();
 
+    /**
+     * Stops a chunked paste and removes the text it inserted, as if the
+     * paste never happened. Does nothing if no chunked paste is active.
+     *
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    void cancelChunkedPaste();
+
 protected Q_SLOTS:
     /**
      * @since 4.1
@@ -384,6 +679,29 @@ protected:
      */
     void contextMenuEvent(QContextMenuEvent *) override;
 
+    /**
+     * Reimplemented to render the formats of copied or dragged text only
+     * when they are requested.
+     *
+     * The selection is frozen when the mime data is created. Only plain text
+     * is offered if acceptRichText() is false, so for large plain texts only
+     * a copy of the selected text is kept. Rich text is kept as a
+     * QTextDocumentFragment and converted to plain text or HTML on request.
+     * When another application takes over the clipboard, the data is
+     * released.
+     *
+     * @since 5.65
+     */
+    QMimeData *createMimeDataFromSelection() const override;
+
+    /**
+     * Reimplemented to insert large pasted or dropped plain text in chunks.
+     *
+     * @see setChunkedPasteThreshold()
+     * @since 5.65
+     */
+    void insertFromMimeData(const QMimeData *source) override;
+
 private:
     class Private;
     Private *const d;
@@ -401,4 +719,6 @@ private:
     Q_PRIVATE_SLOT(d, void slotReplaceText(const QString &, int, int, int))
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(KTextEdit::SpellCheckSkipRegions)
+
 #endif // KTEXTEDIT_H
@@ -0,0 +1,474 @@
+/**
+ * KTextEdit highlighter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "ktextedithighlighter_p.h"
+#include "spellcheckcache_p.h"
+#include "spellcheckworker_p.h"
+#include "ktextwidgets_debug.h"
+
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+
+//@cond PRIVATE
+
+// Marks blocks which still have to be checked, Sonnet does not use block states.
+static const int s_pendingBlockState = -2;
+// Blocks checked at least above and below the visible ones
+static const int s_minimumPrefetchBlocks = 20;
+// Results of the worker applied per event loop iteration
+static const int s_resultBatchSize = 50;
+
+/**
+ * Skip regions and result of the threaded check of a block. Unlike Sonnet's
+ * own cache it is only replaced when the text of the block itself changes.
+ */
+class SpellCheckBlockData : public QTextBlockUserData
+{
+public:
+    SpellCheckBlockData()
+        : hash(0),
+          requestedHash(0),
+          revision(-1),
+          generation(-1),
+          requestedGeneration(-1),
+          classifiedRevision(-1),
+          classifiedGeneration(-1),
+          skipBlock(false)
+    {
+    }
+
+    QVector<int> misspellings;
+    uint hash;
+    uint requestedHash;
+    int revision;
+    int generation;
+    int requestedGeneration;
+
+    QVector<int> skipRanges;
+    int classifiedRevision;
+    int classifiedGeneration;
+    bool skipBlock;
+};
+
+KTextEditHighlighter::KTextEditHighlighter(KTextEdit *textEdit)
+    : Sonnet::Highlighter(textEdit),
+      m_textEdit(textEdit),
+      m_firstBlock(0),
+      m_lastBlock(-1),
+      m_viewportOnly(false),
+      m_skipRegions(KTextEdit::SkipNothing),
+      m_lastTicket(0),
+      m_generation(0),
+      m_cacheGeneration(SpellCheckCache::instance()->generation()),
+      m_highlightNSecs(0),
+      m_highlightedBlocks(0),
+      m_uncountedBlocks(0),
+      m_checkedWords(0),
+      m_cacheHits(0)
+{
+    m_scrollTimer.setSingleShot(true);
+    m_scrollTimer.setInterval(0);
+    connect(&m_scrollTimer, &QTimer::timeout, this, &KTextEditHighlighter::highlightPendingBlocks);
+    connect(textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() {
+        m_scrollTimer.start();
+    });
+    textEdit->viewport()->installEventFilter(this);
+
+    m_resultTimer.setSingleShot(true);
+    m_resultTimer.setInterval(0);
+    connect(&m_resultTimer, &QTimer::timeout, this, &KTextEditHighlighter::applyResults);
+
+    // Fires once all blocks of a highlighting pass are done
+    m_statisticsTimer.setSingleShot(true);
+    m_statisticsTimer.setInterval(0);
+    connect(&m_statisticsTimer, &QTimer::timeout, this, &KTextEditHighlighter::logStatistics);
+}
+
+KTextEditHighlighter::~KTextEditHighlighter()
+{
+    stopWorker();
+}
+
+void KTextEditHighlighter::setViewportOnly(bool viewportOnly)
+{
+    if (viewportOnly == m_viewportOnly) {
+        return;
+    }
+    m_viewportOnly = viewportOnly;
+    if (m_viewportOnly) {
+        updateVisibleRange();
+    } else if (document()) {
+        for (QTextBlock block = document()->begin(); block.isValid(); block = block.next()) {
+            if (block.userState() == s_pendingBlockState) {
+                rehighlightBlock(block);
+            }
+        }
+    }
+}
+
+void KTextEditHighlighter::setThreaded(bool threaded)
+{
+    if (threaded == !m_worker.isNull()) {
+        return;
+    }
+    if (threaded) {
+        SpellCheckWorker *worker = new SpellCheckWorker;
+        worker->moveToThread(&m_workerThread);
+        connect(&m_workerThread, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &SpellCheckWorker::blockChecked, this, &KTextEditHighlighter::queueResult);
+        m_worker = worker;
+        m_workerThread.start(QThread::LowPriority);
+    } else {
+        stopWorker();
+    }
+    if (document()) {
+        rehighlight();
+    }
+}
+
+void KTextEditHighlighter::setSkipRegions(KTextEdit::SpellCheckSkipRegions regions)
+{
+    if (regions == m_skipRegions) {
+        return;
+    }
+    m_skipRegions = regions;
+    ++m_generation;
+    if (document()) {
+        rehighlight();
+    }
+}
+
+void KTextEditHighlighter::invalidateResults()
+{
+    ++m_generation;
+}
+
+void KTextEditHighlighter::acceptWord(const QString &word)
+{
+    // The other text edits check the word again as well, if it was added
+    // to the dictionary it is not misspelled for them either.
+    SpellCheckCache *cache = SpellCheckCache::instance();
+    cache->remove(currentLanguage(), word);
+    m_cacheGeneration = cache->generation();
+    if (m_worker) {
+        SpellCheckWorker *worker = m_worker;
+        QMetaObject::invokeMethod(worker, [worker, word]() {
+            worker->ignoreWord(word);
+        }, Qt::QueuedConnection);
+    }
+    ++m_generation;
+    if (document()) {
+        rehighlight();
+    }
+}
+
+void KTextEditHighlighter::highlightBlock(const QString &text)
+{
+    if (m_viewportOnly) {
+        const int blockNumber = currentBlock().blockNumber();
+        if (blockNumber < m_firstBlock || blockNumber > m_lastBlock) {
+            setCurrentBlockState(s_pendingBlockState);
+            return;
+        }
+        setCurrentBlockState(-1);
+    }
+
+    const bool instrumented = KTEXTWIDGETS_LOG().isDebugEnabled();
+    QElapsedTimer timer;
+    if (instrumented) {
+        timer.start();
+    }
+
+    if (m_worker || m_skipRegions != KTextEdit::SkipNothing) {
+        highlightCached(text);
+    } else {
+        Sonnet::Highlighter::highlightBlock(text);
+        if (instrumented) {
+            ++m_uncountedBlocks;
+        }
+    }
+
+    if (instrumented) {
+        m_highlightNSecs += timer.nsecsElapsed();
+        ++m_highlightedBlocks;
+        m_statisticsTimer.start();
+    }
+}
+
+void KTextEditHighlighter::classifyBlock(const QString &text, SpellCheckBlockData *data) const
+{
+    data->skipRanges.clear();
+    data->skipBlock = !m_textEdit->shouldBlockBeSpellChecked(text);
+    if (data->skipBlock) {
+        return;
+    }
+
+    if (m_skipRegions & KTextEdit::SkipQuotedLines) {
+        for (const QChar c : text) {
+            if (c == QLatin1Char('>')) {
+                data->skipBlock = true;
+                return;
+            }
+            if (!c.isSpace()) {
+                break;
+            }
+        }
+    }
+
+    if (m_skipRegions & KTextEdit::SkipUrls) {
+        static const QRegularExpression urlPattern(QStringLiteral("\\b(?:(?:https?|ftp|file|mailto):|www\\.)\\S+"),
+                                                   QRegularExpression::CaseInsensitiveOption);
+        QRegularExpressionMatchIterator matches = urlPattern.globalMatch(text);
+        while (matches.hasNext()) {
+            const QRegularExpressionMatch match = matches.next();
+            data->skipRanges << match.capturedStart() << match.capturedLength();
+        }
+    }
+
+    if (m_skipRegions & KTextEdit::SkipInlineCode) {
+        int start = text.indexOf(QLatin1Char('`'));
+        while (start != -1) {
+            const int end = text.indexOf(QLatin1Char('`'), start + 1);
+            if (end == -1) {
+                break;
+            }
+            data->skipRanges << start << end - start + 1;
+            start = text.indexOf(QLatin1Char('`'), end + 1);
+        }
+    }
+}
+
+void KTextEditHighlighter::highlightCached(const QString &text)
+{
+    if (text.isEmpty() || !isActive() || !spellCheckerFound()) {
+        return;
+    }
+
+    // Results for another language are outdated, and so are results based
+    // on verdicts removed from the cache, for example because a word was
+    // added to the dictionary in another text edit.
+    const QString language = currentLanguage();
+    const int cacheGeneration = SpellCheckCache::instance()->generation();
+    if (language != m_language || cacheGeneration != m_cacheGeneration) {
+        m_language = language;
+        m_cacheGeneration = cacheGeneration;
+        ++m_generation;
+    }
+
+    SpellCheckBlockData *data = dynamic_cast<SpellCheckBlockData *>(currentBlockUserData());
+    if (!data) {
+        data = new SpellCheckBlockData;
+        setCurrentBlockUserData(data);
+    }
+
+    const int revision = currentBlock().revision();
+    if (data->classifiedRevision != revision || data->classifiedGeneration != m_generation) {
+        classifyBlock(text, data);
+        data->classifiedRevision = revision;
+        data->classifiedGeneration = m_generation;
+    }
+    if (data->skipBlock) {
+        return;
+    }
+
+    if (!m_worker) {
+        // The shared cache is not used here. The speller of the highlighter
+        // also knows the words ignored in this text edit, whose verdicts must
+        // not reach the other text edits, and Sonnet cannot tell them apart
+        // from the words of the dictionary.
+        const bool instrumented = KTEXTWIDGETS_LOG().isDebugEnabled();
+        const QVector<int> misspellings = SpellCheckWorker::findMisspellings(text, data->skipRanges,
+        [this, instrumented](const QString &word) {
+            if (instrumented) {
+                ++m_checkedWords;
+            }
+            return isWordMisspelled(word);
+        });
+        for (int i = 0; i + 1 < misspellings.size(); i += 2) {
+            setMisspelled(misspellings.at(i), misspellings.at(i + 1));
+        }
+        return;
+    }
+
+    uint hash = 0;
+    if (data->generation == m_generation && data->revision != revision) {
+        // The revision also changes when a block is split or merged, which
+        // leaves the text as it was in many cases.
+        hash = qHash(text);
+        if (hash == data->hash) {
+            data->revision = revision;
+        }
+    }
+    if (data->generation == m_generation && data->revision == revision) {
+        for (int i = 0; i + 1 < data->misspellings.size(); i += 2) {
+            setMisspelled(data->misspellings.at(i), data->misspellings.at(i + 1));
+        }
+        return;
+    }
+
+    // Until the result for the changed text arrives, the previous one is
+    // shown, so the underlines of the edited block do not flicker.
+    if (data->generation == m_generation) {
+        const int length = text.length();
+        for (int i = 0; i + 1 < data->misspellings.size(); i += 2) {
+            const int start = data->misspellings.at(i);
+            if (start < length) {
+                setMisspelled(start, qMin(data->misspellings.at(i + 1), length - start));
+            }
+        }
+    }
+
+    if (hash == 0) {
+        hash = qHash(text);
+    }
+    if (data->requestedHash == hash && data->requestedGeneration == m_generation) {
+        return;
+    }
+    data->requestedHash = hash;
+    data->requestedGeneration = m_generation;
+
+    const quint64 ticket = ++m_lastTicket;
+    const PendingCheck pending = { QTextCursor(currentBlock()), hash, m_generation };
+    m_pendingChecks.insert(ticket, pending);
+
+    SpellCheckWorker *worker = m_worker;
+    const QVector<int> skipRanges = data->skipRanges;
+    QMetaObject::invokeMethod(worker, [worker, ticket, text, skipRanges, language]() {
+        worker->checkBlock(ticket, text, skipRanges, language);
+    }, Qt::QueuedConnection);
+}
+
+void KTextEditHighlighter::queueResult(quint64 ticket, const QVector<int> &misspellings, int words, int cacheHits)
+{
+    if (KTEXTWIDGETS_LOG().isDebugEnabled()) {
+        m_checkedWords += words;
+        m_cacheHits += cacheHits;
+    }
+
+    const CheckResult result = { ticket, misspellings };
+    m_results.append(result);
+    if (!m_resultTimer.isActive()) {
+        m_resultTimer.start();
+    }
+}
+
+void KTextEditHighlighter::applyResults()
+{
+    const int count = qMin(m_results.size(), s_resultBatchSize);
+    for (int i = 0; i < count; ++i) {
+        const CheckResult &result = m_results.at(i);
+        // The cursor follows the block through edits and is reset when the
+        // document is deleted.
+        const PendingCheck pending = m_pendingChecks.take(result.ticket);
+        if (pending.cursor.isNull() || pending.cursor.document() != document()
+                || pending.generation != m_generation) {
+            continue;
+        }
+        const QTextBlock block = pending.cursor.block();
+        if (qHash(block.text()) != pending.hash) {
+            continue;
+        }
+        SpellCheckBlockData *data = dynamic_cast<SpellCheckBlockData *>(block.userData());
+        if (!data) {
+            continue;
+        }
+        data->misspellings = result.misspellings;
+        data->hash = pending.hash;
+        data->revision = block.revision();
+        data->generation = pending.generation;
+        rehighlightBlock(block);
+    }
+    m_results.remove(0, count);
+    if (!m_results.isEmpty()) {
+        m_resultTimer.start();
+    }
+}
+
+void KTextEditHighlighter::stopWorker()
+{
+    if (!m_worker) {
+        return;
+    }
+    // The worker is deleted by the finished thread.
+    m_workerThread.quit();
+    m_workerThread.wait();
+    m_worker = nullptr;
+    m_pendingChecks.clear();
+    m_results.clear();
+    m_resultTimer.stop();
+}
+
+void KTextEditHighlighter::logStatistics()
+{
+    if (m_uncountedBlocks == m_highlightedBlocks) {
+        // Sonnet::Highlighter does not tell how many words it checked.
+        qCDebug(KTEXTWIDGETS_LOG) << "Spell checked" << m_highlightedBlocks << "blocks in"
+                                  << m_highlightNSecs / 1000000.0 << "ms";
+    } else {
+        qCDebug(KTEXTWIDGETS_LOG) << "Spell checked" << m_highlightedBlocks << "blocks in"
+                                  << m_highlightNSecs / 1000000.0 << "ms," << m_checkedWords << "words checked in"
+                                  << m_highlightedBlocks - m_uncountedBlocks << "of them,"
+                                  << m_cacheHits << "words found in the cache";
+    }
+    m_highlightNSecs = 0;
+    m_highlightedBlocks = 0;
+    m_uncountedBlocks = 0;
+    m_checkedWords = 0;
+    m_cacheHits = 0;
+}
+
+bool KTextEditHighlighter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_textEdit->viewport() && event->type() == QEvent::Resize) {
+        m_scrollTimer.start();
+    }
+    return Sonnet::Highlighter::eventFilter(watched, event);
+}
+
+void KTextEditHighlighter::updateVisibleRange()
+{
+    const QRect rect = m_textEdit->viewport()->rect();
+    const int first = m_textEdit->cursorForPosition(rect.topLeft()).blockNumber();
+    const int last = m_textEdit->cursorForPosition(rect.bottomRight()).blockNumber();
+    const int margin = qMax(last - first + 1, s_minimumPrefetchBlocks);
+    m_firstBlock = first - margin;
+    m_lastBlock = last + margin;
+}
+
+void KTextEditHighlighter::highlightPendingBlocks()
+{
+    if (!m_viewportOnly || !document()) {
+        return;
+    }
+    updateVisibleRange();
+    // Checking a pending block changes its state, so QSyntaxHighlighter
+    // continues with the next block, which then is not pending anymore.
+    for (QTextBlock block = document()->findBlockByNumber(qMax(0, m_firstBlock));
+            block.isValid() && block.blockNumber() <= m_lastBlock; block = block.next()) {
+        if (block.userState() == s_pendingBlockState) {
+            rehighlightBlock(block);
+        }
+    }
+}
+
+//@endcond
@@ -0,0 +1,140 @@
+/**
+ * KTextEdit highlighter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef KTEXTEDITHIGHLIGHTER_H
+#define KTEXTEDITHIGHLIGHTER_H
+
+//@cond PRIVATE
+
+#include <QHash>
+#include <QPointer>
+#include <QTextCursor>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include <sonnet/highlighter.h>
+
+#include "ktextedit.h"
+
+class SpellCheckBlockData;
+class SpellCheckWorker;
+
+/**
+ * @short The highlighter created by KTextEdit::createHighlighter()
+ *
+ * When restricted to the viewport, it only checks the blocks around the
+ * visible area. The other blocks are marked with a block state and checked
+ * once they are scrolled into view.
+ *
+ * In threaded mode the words are checked by a SpellCheckWorker. The result
+ * of each block is cached in its user data together with the revision and
+ * the hash of the checked text, so a block is only checked again when its
+ * own text changes. The results are applied in batches from the event loop.
+ *
+ * Skip regions are found once per change of a block and cached in its user
+ * data as well. As Sonnet's own block cache would replace that user data,
+ * the words are checked with isWordMisspelled() in that case, instead of by
+ * Sonnet::Highlighter::highlightBlock().
+ *
+ * If debug output of the kf5.ktextwidgets logging category is enabled, the
+ * number of blocks and words checked and the time spent is logged after
+ * each highlighting pass.
+ *
+ * @internal
+ */
+class KTextEditHighlighter : public Sonnet::Highlighter
+{
+public:
+    explicit KTextEditHighlighter(KTextEdit *textEdit);
+    ~KTextEditHighlighter() override;
+
+    void setViewportOnly(bool viewportOnly);
+    void setThreaded(bool threaded);
+    void setSkipRegions(KTextEdit::SpellCheckSkipRegions regions);
+
+    /**
+     * Discards the cached results of threaded checking, so that the blocks
+     * are checked again on the next rehighlight.
+     */
+    void invalidateResults();
+
+    /**
+     * Called after @p word was ignored or added to the dictionary with
+     * ignoreWord() or addWordToDictionary(). Passes it on to the worker,
+     * removes its verdict from SpellCheckCache and checks the blocks again,
+     * as the cached results may contain it.
+     */
+    void acceptWord(const QString &word);
+
+protected:
+    void highlightBlock(const QString &text) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct PendingCheck {
+        QTextCursor cursor;
+        uint hash;
+        int generation;
+    };
+    struct CheckResult {
+        quint64 ticket;
+        QVector<int> misspellings;
+    };
+
+    void updateVisibleRange();
+    void highlightPendingBlocks();
+    void highlightCached(const QString &text);
+    void classifyBlock(const QString &text, SpellCheckBlockData *data) const;
+    void queueResult(quint64 ticket, const QVector<int> &misspellings, int words, int cacheHits);
+    void applyResults();
+    void stopWorker();
+    void logStatistics();
+
+    KTextEdit *m_textEdit;
+    QTimer m_scrollTimer;
+    int m_firstBlock;
+    int m_lastBlock;
+    bool m_viewportOnly;
+    KTextEdit::SpellCheckSkipRegions m_skipRegions;
+
+    QThread m_workerThread;
+    QPointer<SpellCheckWorker> m_worker;
+    QHash<quint64, PendingCheck> m_pendingChecks;
+    QVector<CheckResult> m_results;
+    QTimer m_resultTimer;
+    QString m_language;
+    quint64 m_lastTicket;
+    int m_generation;
+    // The generation of SpellCheckCache the cached results are based on
+    int m_cacheGeneration;
+
+    // Only counted while debug output is enabled
+    QTimer m_statisticsTimer;
+    qint64 m_highlightNSecs;
+    int m_highlightedBlocks;
+    // Blocks checked by Sonnet::Highlighter, whose words are not counted
+    int m_uncountedBlocks;
+    int m_checkedWords;
+    int m_cacheHits;
+};
+
+//@endcond
+
+#endif
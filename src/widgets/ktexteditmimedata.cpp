@@ -0,0 +1,148 @@
+/**
+ * KTextEdit mime data
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "ktexteditmimedata_p.h"
+
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QTextCursor>
+
+//@cond PRIVATE
+
+static QString plainTextFormat()
+{
+    return QStringLiteral("text/plain");
+}
+
+static QString htmlFormat()
+{
+    return QStringLiteral("text/html");
+}
+
+KTextEditMimeData::KTextEditMimeData(const QTextCursor &cursor, bool richText)
+    : mRichText(richText),
+      mPlainTextRendered(false),
+      mHtmlRendered(false),
+      mOnClipboard(false),
+      mReleased(false)
+{
+    if (mRichText) {
+        mFragment = QTextDocumentFragment(cursor);
+    } else {
+        mPlainText = cursor.selectedText();
+    }
+
+    connect(QGuiApplication::clipboard(), &QClipboard::changed,
+            this, &KTextEditMimeData::slotClipboardChanged);
+}
+
+KTextEditMimeData::~KTextEditMimeData()
+{
+}
+
+QStringList KTextEditMimeData::formats() const
+{
+    if (mReleased) {
+        return QStringList();
+    }
+    if (mRichText) {
+        return QStringList{plainTextFormat(), htmlFormat()};
+    }
+    return QStringList{plainTextFormat()};
+}
+
+QVariant KTextEditMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+    Q_UNUSED(type);
+    if (mReleased) {
+        return QVariant();
+    }
+    if (mimeType == plainTextFormat()) {
+        return plainText();
+    }
+    if (mRichText && mimeType == htmlFormat()) {
+        return html();
+    }
+    return QVariant();
+}
+
+QString KTextEditMimeData::plainText() const
+{
+    if (!mPlainTextRendered) {
+        if (mRichText) {
+            mPlainText = mFragment.toPlainText();
+        } else {
+            // Same conversion as QTextDocumentFragment::toPlainText(), but
+            // in place, as the selected text is not shared.
+            QChar *data = mPlainText.data();
+            for (int i = 0, size = mPlainText.size(); i < size; ++i) {
+                switch (data[i].unicode()) {
+                case QChar::ParagraphSeparator:
+                case QChar::LineSeparator:
+                    data[i] = QLatin1Char('\n');
+                    break;
+                case QChar::Nbsp:
+                    data[i] = QLatin1Char(' ');
+                    break;
+                }
+            }
+        }
+        mPlainTextRendered = true;
+        dropFragmentIfRendered();
+    }
+    return mPlainText;
+}
+
+QString KTextEditMimeData::html() const
+{
+    if (!mHtmlRendered) {
+        mHtml = mFragment.toHtml("utf-8");
+        mHtmlRendered = true;
+        dropFragmentIfRendered();
+    }
+    return mHtml;
+}
+
+void KTextEditMimeData::dropFragmentIfRendered() const
+{
+    if (mPlainTextRendered && mHtmlRendered) {
+        mFragment = QTextDocumentFragment();
+    }
+}
+
+void KTextEditMimeData::slotClipboardChanged()
+{
+    const QClipboard *clipboard = QGuiApplication::clipboard();
+    const bool onClipboard = (clipboard->ownsClipboard() && clipboard->mimeData(QClipboard::Clipboard) == this)
+                             || (clipboard->ownsSelection() && clipboard->mimeData(QClipboard::Selection) == this);
+    if (onClipboard) {
+        mOnClipboard = true;
+    } else if (mOnClipboard && !mReleased) {
+        // Mime data used for dragging is never on the clipboard, so it is
+        // not released here.
+        mReleased = true;
+        mFragment = QTextDocumentFragment();
+        mPlainText.clear();
+        mPlainText.squeeze();
+        mHtml.clear();
+        mHtml.squeeze();
+    }
+}
+
+//@endcond
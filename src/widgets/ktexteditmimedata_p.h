@@ -0,0 +1,80 @@
+/**
+ * KTextEdit mime data
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef KTEXTEDITMIMEDATA_H
+#define KTEXTEDITMIMEDATA_H
+
+//@cond PRIVATE
+
+#include <QMimeData>
+#include <QTextDocumentFragment>
+
+class QTextCursor;
+
+/**
+ * @short The mime data created by KTextEdit for copies and drags
+ *
+ * The selected range is frozen when the mime data is created, as compact as
+ * possible: for plain text only the selected text is copied, for rich text
+ * a QTextDocumentFragment. The plain text and HTML formats are only rendered
+ * when they are requested, each at most once.
+ *
+ * Once the mime data was put on the clipboard and another owner takes the
+ * clipboard over, the frozen range and everything rendered from it is
+ * released, even if the platform keeps the mime data object alive.
+ *
+ * @internal
+ */
+class KTextEditMimeData : public QMimeData
+{
+    Q_OBJECT
+public:
+    /**
+     * Freezes the selection of @p cursor. Without @p richText only the
+     * plain text format is offered.
+     */
+    KTextEditMimeData(const QTextCursor &cursor, bool richText);
+    ~KTextEditMimeData() override;
+
+    QStringList formats() const override;
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+
+private:
+    QString plainText() const;
+    QString html() const;
+    void dropFragmentIfRendered() const;
+    void slotClipboardChanged();
+
+    const bool mRichText;
+    // Only set for rich text, dropped when all formats are rendered
+    mutable QTextDocumentFragment mFragment;
+    // For plain text the selected text, until it is rendered in place
+    mutable QString mPlainText;
+    mutable bool mPlainTextRendered;
+    mutable QString mHtml;
+    mutable bool mHtmlRendered;
+    bool mOnClipboard;
+    bool mReleased;
+};
+
+//@endcond
+
+#endif
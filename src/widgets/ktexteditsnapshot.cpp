@@ -0,0 +1,202 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "ktexteditsnapshot.h"
+#include "ktexteditsnapshot_p.h"
+
+#include <QTextBlock>
+
+#include <algorithm>
+
+// A chunk holds at most this many paragraphs. Smaller chunks make a change
+// cheaper, larger ones the snapshot.
+static const int s_blocksPerChunk = 256;
+
+KTextEditSnapshot::KTextEditSnapshot()
+    : d(new KTextEditSnapshotPrivate)
+{
+}
+
+KTextEditSnapshot::KTextEditSnapshot(KTextEditSnapshotPrivate *dd)
+    : d(dd)
+{
+}
+
+KTextEditSnapshot::KTextEditSnapshot(const KTextEditSnapshot &other) = default;
+
+KTextEditSnapshot::~KTextEditSnapshot() = default;
+
+KTextEditSnapshot &KTextEditSnapshot::operator=(const KTextEditSnapshot &other) = default;
+
+bool KTextEditSnapshot::isNull() const
+{
+    return d->revision == -1;
+}
+
+int KTextEditSnapshot::revision() const
+{
+    return d->revision;
+}
+
+int KTextEditSnapshot::blockCount() const
+{
+    return d->blockCount;
+}
+
+QString KTextEditSnapshot::blockText(int blockNumber) const
+{
+    if (blockNumber < 0 || blockNumber >= d->blockCount) {
+        return QString();
+    }
+    const auto it = std::upper_bound(d->firstBlocks.constBegin(), d->firstBlocks.constEnd(), blockNumber) - 1;
+    const int index = it - d->firstBlocks.constBegin();
+    const KTextEditSnapshotChunk &chunk = *d->chunks.at(index);
+    const int block = blockNumber - *it;
+    const int start = chunk.blockStarts.at(block);
+    const int end = block + 1 < chunk.blockStarts.size() ? chunk.blockStarts.at(block + 1) : chunk.text.size();
+    return chunk.text.mid(start, end - start);
+}
+
+int KTextEditSnapshot::length() const
+{
+    return d->length;
+}
+
+QString KTextEditSnapshot::toPlainText() const
+{
+    QString text;
+    text.reserve(d->length);
+    bool firstBlock = true;
+    for (const auto &chunk : qAsConst(d->chunks)) {
+        const int count = chunk->blockStarts.size();
+        for (int i = 0; i < count; ++i) {
+            if (!firstBlock) {
+                text += QLatin1Char('\n');
+            }
+            firstBlock = false;
+            const int start = chunk->blockStarts.at(i);
+            const int end = i + 1 < count ? chunk->blockStarts.at(i + 1) : chunk->text.size();
+            text += QStringRef(&chunk->text, start, end - start);
+        }
+    }
+    return text;
+}
+
+//@cond PRIVATE
+
+KTextEditSnapshotBuilder::KTextEditSnapshotBuilder(QTextDocument *document)
+    : m_document(document),
+      m_blockCount(document->blockCount())
+{
+    m_entries.append({QSharedPointer<const KTextEditSnapshotChunk>(), m_blockCount});
+    m_connection = QObject::connect(document, &QTextDocument::contentsChange, document,
+                                    [this](int position, int charsRemoved, int charsAdded) {
+        contentsChange(position, charsRemoved, charsAdded);
+    });
+}
+
+KTextEditSnapshotBuilder::~KTextEditSnapshotBuilder()
+{
+    QObject::disconnect(m_connection);
+}
+
+QTextDocument *KTextEditSnapshotBuilder::document() const
+{
+    return m_document;
+}
+
+void KTextEditSnapshotBuilder::contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+    const int blockCount = m_document->blockCount();
+    const int delta = blockCount - m_blockCount;
+    m_blockCount = blockCount;
+
+    // The paragraphs first to lastOld were replaced by first to lastNew
+    QTextBlock block = m_document->findBlock(position);
+    const int first = block.isValid() ? block.blockNumber() : blockCount - 1;
+    block = m_document->findBlock(position + charsAdded);
+    const int lastNew = block.isValid() ? block.blockNumber() : blockCount - 1;
+    const int lastOld = lastNew - delta;
+
+    // Merge the entries holding them into one range of changed paragraphs.
+    // The entries always add up to the paragraph count of the document.
+    int begin = 0;
+    int entryStart = 0;
+    while (begin < m_entries.size() - 1 && entryStart + m_entries.at(begin).blockCount <= first) {
+        entryStart += m_entries.at(begin).blockCount;
+        ++begin;
+    }
+    int end = begin;
+    int oldCount = 0;
+    while (end < m_entries.size() && (end == begin || entryStart + oldCount <= lastOld)) {
+        oldCount += m_entries.at(end).blockCount;
+        ++end;
+    }
+    m_entries[begin] = {QSharedPointer<const KTextEditSnapshotChunk>(), oldCount + delta};
+    m_entries.remove(begin + 1, end - begin - 1);
+}
+
+KTextEditSnapshot KTextEditSnapshotBuilder::snapshot()
+{
+    KTextEditSnapshotPrivate *snapshot = new KTextEditSnapshotPrivate;
+    snapshot->revision = m_document->revision();
+    snapshot->blockCount = m_document->blockCount();
+
+    QVector<Entry> entries;
+    entries.reserve(m_entries.size());
+    int blockNumber = 0;
+    for (const Entry &entry : qAsConst(m_entries)) {
+        if (entry.chunk) {
+            entries.append(entry);
+            blockNumber += entry.blockCount;
+            continue;
+        }
+        // Read the changed paragraphs into new chunks
+        QTextBlock block = m_document->findBlockByNumber(blockNumber);
+        int remaining = entry.blockCount;
+        while (remaining > 0 && block.isValid()) {
+            const int count = qMin(remaining, s_blocksPerChunk);
+            QSharedPointer<KTextEditSnapshotChunk> chunk = QSharedPointer<KTextEditSnapshotChunk>::create();
+            chunk->blockStarts.reserve(count);
+            int read = 0;
+            for (; read < count && block.isValid(); ++read, block = block.next()) {
+                chunk->blockStarts.append(chunk->text.size());
+                chunk->text += block.text();
+            }
+            chunk->text.squeeze();
+            entries.append({chunk, read});
+            remaining -= read;
+            blockNumber += read;
+        }
+    }
+    m_entries = entries;
+
+    snapshot->chunks.reserve(m_entries.size());
+    snapshot->firstBlocks.reserve(m_entries.size());
+    int firstBlock = 0;
+    for (const Entry &entry : qAsConst(m_entries)) {
+        snapshot->chunks.append(entry.chunk);
+        snapshot->firstBlocks.append(firstBlock);
+        firstBlock += entry.blockCount;
+        snapshot->length += entry.chunk->text.size();
+    }
+    snapshot->length += qMax(0, snapshot->blockCount - 1);
+    return KTextEditSnapshot(snapshot);
+}
+
+//@endcond
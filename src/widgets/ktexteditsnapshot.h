@@ -0,0 +1,101 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef KTEXTEDITSNAPSHOT_H
+#define KTEXTEDITSNAPSHOT_H
+
+#include <ktextwidgets_export.h>
+
+#include <QMetaType>
+#include <QSharedDataPointer>
+#include <QString>
+
+class KTextEditSnapshotPrivate;
+
+/**
+ * @class KTextEditSnapshot ktexteditsnapshot.h <KTextEditSnapshot>
+ *
+ * @brief An immutable copy of the plain text of a KTextEdit.
+ *
+ * A snapshot is created with KTextEdit::snapshot() in the thread of the
+ * text edit. Afterwards it never changes, and it may be copied to and read
+ * from any thread, for example to save, search or export the text in the
+ * background while the user keeps on editing.
+ *
+ * Snapshots are implicitly shared, so copying one is cheap. The text is
+ * stored in chunks of paragraphs, and successive snapshots of the same
+ * text edit share the chunks of the paragraphs which did not change in
+ * between, so taking a snapshot costs about the size of the changed
+ * paragraphs.
+ *
+ * @since 5.65
+ */
+class KTEXTWIDGETS_EXPORT KTextEditSnapshot
+{
+public:
+    /**
+     * Constructs an empty snapshot.
+     */
+    KTextEditSnapshot();
+    KTextEditSnapshot(const KTextEditSnapshot &other);
+    ~KTextEditSnapshot();
+    KTextEditSnapshot &operator=(const KTextEditSnapshot &other);
+
+    /**
+     * @return true if this snapshot was not created by KTextEdit::snapshot()
+     */
+    bool isNull() const;
+
+    /**
+     * @return the QTextDocument::revision() of the document when the
+     *         snapshot was taken
+     */
+    int revision() const;
+
+    /**
+     * @return the number of paragraphs; an empty text has one
+     */
+    int blockCount() const;
+
+    /**
+     * @return the text of the paragraph @p blockNumber, or an empty string
+     *         if there is no such paragraph
+     */
+    QString blockText(int blockNumber) const;
+
+    /**
+     * @return the number of characters of the text, counting one for each
+     *         line break
+     */
+    int length() const;
+
+    /**
+     * @return the whole text, with the paragraphs separated by '\\n'
+     */
+    QString toPlainText() const;
+
+private:
+    //@cond PRIVATE
+    friend class KTextEditSnapshotBuilder;
+    explicit KTextEditSnapshot(KTextEditSnapshotPrivate *dd);
+    QSharedDataPointer<KTextEditSnapshotPrivate> d;
+    //@endcond
+};
+
+Q_DECLARE_METATYPE(KTextEditSnapshot)
+
+#endif
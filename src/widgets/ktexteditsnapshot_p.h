@@ -0,0 +1,92 @@
+/**
+ * KTextEdit snapshot builder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef KTEXTEDITSNAPSHOT_P_H
+#define KTEXTEDITSNAPSHOT_P_H
+
+//@cond PRIVATE
+
+#include <QMetaObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTextDocument>
+#include <QVector>
+
+#include "ktexteditsnapshot.h"
+
+/**
+ * The texts of consecutive paragraphs. Never changed once created, so it
+ * may be read from any thread.
+ */
+struct KTextEditSnapshotChunk {
+    // The paragraphs, without separators
+    QString text;
+    // The position of each paragraph in text
+    QVector<int> blockStarts;
+};
+
+class KTextEditSnapshotPrivate : public QSharedData
+{
+public:
+    QVector<QSharedPointer<const KTextEditSnapshotChunk>> chunks;
+    // The number of the first paragraph of each chunk
+    QVector<int> firstBlocks;
+    int revision = -1;
+    int blockCount = 0;
+    int length = 0;
+};
+
+/**
+ * @short Creates the snapshots of a document
+ *
+ * Follows the contentsChange() signal of the document and remembers which
+ * chunks of the last snapshot were changed, so that only those have to be
+ * read from the document for the next one.
+ *
+ * @internal
+ */
+class KTextEditSnapshotBuilder
+{
+public:
+    explicit KTextEditSnapshotBuilder(QTextDocument *document);
+    ~KTextEditSnapshotBuilder();
+
+    QTextDocument *document() const;
+    KTextEditSnapshot snapshot();
+
+private:
+    // A chunk of the last snapshot, or a range of changed paragraphs if
+    // chunk is null
+    struct Entry {
+        QSharedPointer<const KTextEditSnapshotChunk> chunk;
+        int blockCount;
+    };
+
+    void contentsChange(int position, int charsRemoved, int charsAdded);
+
+    QPointer<QTextDocument> m_document;
+    QMetaObject::Connection m_connection;
+    QVector<Entry> m_entries;
+    // The paragraph count of the document as of the last change
+    int m_blockCount;
+};
+
+//@endcond
+
+#endif
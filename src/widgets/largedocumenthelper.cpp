@@ -0,0 +1,241 @@
+/**
+ * Large document helper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "largedocumenthelper_p.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QEvent>
+#include <QFontMetrics>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextEdit>
+
+//@cond PRIVATE
+
+// The window holds this many pages, but never less than the minimum, so that
+// small scroll steps rarely move it.
+static const int s_windowPages = 5;
+static const int s_minimumWindowLines = 200;
+
+LargeDocumentHelper::LargeDocumentHelper(QTextEdit *edit)
+    : QObject(edit),
+      mEdit(edit),
+      mScrollBar(new QScrollBar(Qt::Vertical, edit)),
+      mWindowStart(0),
+      mWindowLines(0),
+      mUpdating(false),
+      mLoading(false)
+{
+    mScrollBar->setSingleStep(1);
+    mScrollBar->show();
+    mEdit->viewport()->installEventFilter(this);
+
+    connect(mEdit->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &LargeDocumentHelper::slotViewScrolled);
+    connect(mScrollBar, &QScrollBar::valueChanged,
+            this, &LargeDocumentHelper::slotScrollBarMoved);
+
+    updateScrollBarGeometry();
+}
+
+LargeDocumentHelper::~LargeDocumentHelper()
+{
+    mEdit->viewport()->removeEventFilter(this);
+    delete mScrollBar;
+}
+
+void LargeDocumentHelper::setText(const QByteArray &text)
+{
+    mText = text;
+
+    // The same line breaks as in QTextDocument::setPlainText(): LF, CR LF,
+    // CR and the Unicode paragraph separator.
+    mLineStarts.clear();
+    mLineStarts.append(0);
+    const char *data = mText.constData();
+    const int size = mText.size();
+    for (int pos = 0; pos < size; ++pos) {
+        const char c = data[pos];
+        if (c == '\n') {
+            mLineStarts.append(pos + 1);
+        } else if (c == '\r') {
+            if (pos + 1 < size && data[pos + 1] == '\n') {
+                ++pos;
+            }
+            mLineStarts.append(pos + 1);
+        } else if (c == '\xe2' && pos + 2 < size && data[pos + 1] == '\x80' && data[pos + 2] == '\xa9') {
+            pos += 2;
+            mLineStarts.append(pos + 1);
+        }
+    }
+
+    mUpdating = true;
+    loadWindow(0);
+    updateScrollBar();
+    mScrollBar->setValue(0);
+    mEdit->verticalScrollBar()->setValue(0);
+    mUpdating = false;
+}
+
+int LargeDocumentHelper::lineCount() const
+{
+    return mLineStarts.count();
+}
+
+int LargeDocumentHelper::topLine() const
+{
+    return mWindowStart + mEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+}
+
+QScrollBar *LargeDocumentHelper::scrollBar() const
+{
+    return mScrollBar;
+}
+
+bool LargeDocumentHelper::isLoading() const
+{
+    return mLoading;
+}
+
+int LargeDocumentHelper::lineEnd(int line) const
+{
+    if (line + 1 >= mLineStarts.size()) {
+        return mText.size();
+    }
+    // Excludes the line break in front of the next line
+    const int next = mLineStarts.at(line + 1);
+    const char last = mText.at(next - 1);
+    if (last == '\n') {
+        return next >= 2 && mText.at(next - 2) == '\r' ? next - 2 : next - 1;
+    }
+    if (last == '\r') {
+        return next - 1;
+    }
+    return next - 3;
+}
+
+bool LargeDocumentHelper::needsNewWindow(int line) const
+{
+    const int page = linesPerPage();
+    const int windowEnd = mWindowStart + mWindowLines;
+    return line < mWindowStart
+           || (line - mWindowStart < page && mWindowStart > 0)
+           || (windowEnd - line < 2 * page && windowEnd < lineCount());
+}
+
+void LargeDocumentHelper::scrollToLine(int line)
+{
+    line = qBound(0, line, lineCount() - 1);
+
+    const bool wasUpdating = mUpdating;
+    mUpdating = true;
+    if (needsNewWindow(line)) {
+        loadWindow(line - 2 * linesPerPage());
+    }
+
+    QTextDocument *doc = mEdit->document();
+    const QTextBlock block = doc->findBlockByNumber(line - mWindowStart);
+    const QRectF blockRect = doc->documentLayout()->blockBoundingRect(block);
+    mEdit->verticalScrollBar()->setValue(qRound(blockRect.top()));
+    mScrollBar->setValue(line);
+    mUpdating = wasUpdating;
+}
+
+void LargeDocumentHelper::loadWindow(int firstLine)
+{
+    const int total = lineCount();
+    const int windowLines = qMax(linesPerPage() * s_windowPages, s_minimumWindowLines);
+    mWindowStart = qBound(0, firstLine, qMax(0, total - windowLines));
+    const int windowEnd = qMin(total, mWindowStart + windowLines);
+    mWindowLines = windowEnd - mWindowStart;
+
+    // The line break in front of the next line is not part of the window.
+    const int begin = mLineStarts.at(mWindowStart);
+    const int end = lineEnd(windowEnd - 1);
+    const QString text = QString::fromUtf8(mText.constData() + begin, end - begin);
+
+    // Replacing the content drops the layouts of all lines which left the window.
+    mLoading = true;
+    mEdit->document()->setPlainText(text);
+    mLoading = false;
+}
+
+void LargeDocumentHelper::updateScrollBar()
+{
+    const int page = linesPerPage();
+    const QSignalBlocker blocker(mScrollBar);
+    mScrollBar->setRange(0, qMax(0, lineCount() - page));
+    mScrollBar->setPageStep(page);
+}
+
+void LargeDocumentHelper::updateScrollBarGeometry()
+{
+    const QRect viewportRect = mEdit->viewport()->geometry();
+    const int width = mScrollBar->sizeHint().width();
+    const int x = mEdit->isRightToLeft() ? viewportRect.left() - width : viewportRect.right() + 1;
+    mScrollBar->setGeometry(x, viewportRect.top(), width, viewportRect.height());
+}
+
+int LargeDocumentHelper::linesPerPage() const
+{
+    const QFontMetrics metrics(mEdit->document()->defaultFont());
+    return qMax(1, mEdit->viewport()->height() / qMax(1, metrics.lineSpacing()));
+}
+
+void LargeDocumentHelper::slotViewScrolled()
+{
+    if (mUpdating) {
+        return;
+    }
+    const int top = topLine();
+    if (needsNewWindow(top)) {
+        scrollToLine(top);
+    } else {
+        const QSignalBlocker blocker(mScrollBar);
+        mScrollBar->setValue(top);
+    }
+}
+
+void LargeDocumentHelper::slotScrollBarMoved(int line)
+{
+    if (!mUpdating) {
+        scrollToLine(line);
+    }
+}
+
+bool LargeDocumentHelper::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == mEdit->viewport()) {
+        if (event->type() == QEvent::Move) {
+            updateScrollBarGeometry();
+        } else if (event->type() == QEvent::Resize) {
+            updateScrollBarGeometry();
+            const int top = topLine();
+            updateScrollBar();
+            if (needsNewWindow(top)) {
+                scrollToLine(top);
+            }
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+//@endcond
@@ -0,0 +1,110 @@
+/**
+ * Large document helper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef LARGEDOCUMENTHELPER_H
+#define LARGEDOCUMENTHELPER_H
+
+//@cond PRIVATE
+
+#include <QByteArray>
+#include <QObject>
+#include <QVector>
+
+class QScrollBar;
+class QTextEdit;
+
+/**
+ * @short Shows a window of a huge plain text in a QTextEdit
+ *
+ * Only the lines around the visible area are put into the document of the
+ * text edit, so only those are laid out. When the user scrolls near the edge
+ * of that window, the window is moved and the layouts of the lines which
+ * left it are released with the old document content.
+ *
+ * The text edit's own vertical scroll bar only covers the window, so it has
+ * to be hidden. The helper provides a replacement, whose geometry is
+ * estimated from the number of lines of the whole text, and keeps it next to
+ * the viewport. The owner has to reserve space for it with viewport margins.
+ *
+ * @internal
+ */
+class LargeDocumentHelper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LargeDocumentHelper(QTextEdit *edit);
+    ~LargeDocumentHelper() override;
+
+    /**
+     * Indexes the lines of the UTF-8 encoded @p text and shows its beginning.
+     * The data is not copied, if @p text is a raw data array it must outlive
+     * the helper.
+     */
+    void setText(const QByteArray &text);
+
+    int lineCount() const;
+
+    /**
+     * @return The line of the whole text at the top of the viewport
+     */
+    int topLine() const;
+
+    /**
+     * Scrolls the line @p line of the whole text to the top of the viewport,
+     * moving the window if needed.
+     */
+    void scrollToLine(int line);
+
+    /**
+     * @return The scroll bar which represents the whole text
+     */
+    QScrollBar *scrollBar() const;
+
+    /**
+     * @return true while the helper replaces the content of the document,
+     * to tell its changes from changes by others
+     */
+    bool isLoading() const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    bool needsNewWindow(int line) const;
+    int lineEnd(int line) const;
+    void loadWindow(int firstLine);
+    void updateScrollBar();
+    void updateScrollBarGeometry();
+    int linesPerPage() const;
+    void slotViewScrolled();
+    void slotScrollBarMoved(int line);
+
+    QTextEdit *const mEdit;
+    QScrollBar *const mScrollBar;
+    QByteArray mText;
+    QVector<int> mLineStarts;
+    int mWindowStart;
+    int mWindowLines;
+    bool mUpdating;
+    bool mLoading;
+};
+
+//@endcond
+
+#endif
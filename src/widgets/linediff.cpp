@@ -0,0 +1,141 @@
+/**
+ * Line diff
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "linediff_p.h"
+
+#include <QHash>
+
+#include <algorithm>
+
+//@cond PRIVATE
+
+QVector<LineDiff::Hunk> LineDiff::compute(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines, int maxEdits)
+{
+    const int n = oldLines.size();
+    const int m = newLines.size();
+    QVector<Hunk> hunks;
+    if (n == 0 && m == 0) {
+        return hunks;
+    }
+    if (n == 0 || m == 0) {
+        hunks.append({0, n, 0, m});
+        return hunks;
+    }
+
+    // Equal lines get equal numbers, so the comparisons below are cheap
+    QHash<QStringRef, int> ids;
+    ids.reserve(n + m);
+    QVector<int> a(n);
+    QVector<int> b(m);
+    for (int i = 0; i < n; ++i) {
+        auto it = ids.find(oldLines.at(i));
+        if (it == ids.end()) {
+            it = ids.insert(oldLines.at(i), ids.size());
+        }
+        a[i] = it.value();
+    }
+    for (int i = 0; i < m; ++i) {
+        const auto it = ids.constFind(newLines.at(i));
+        b[i] = it == ids.constEnd() ? -1 : it.value();
+    }
+
+    // v[k + max] is the furthest x reached on diagonal k = x - y. The
+    // part of v used by each step d is kept for finding the path back.
+    const int max = qMin(n + m, maxEdits);
+    QVector<int> v(2 * max + 3, 0);
+    QVector<QVector<int>> trace;
+    int found = -1;
+    for (int d = 0; d <= max && found == -1; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v.at(k - 1 + max + 1) < v.at(k + 1 + max + 1))) {
+                x = v.at(k + 1 + max + 1);
+            } else {
+                x = v.at(k - 1 + max + 1) + 1;
+            }
+            int y = x - k;
+            while (x < n && y < m && a.at(x) == b.at(y)) {
+                ++x;
+                ++y;
+            }
+            v[k + max + 1] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+        trace.append(v.mid(max + 1 - d, 2 * d + 1));
+    }
+    if (found == -1) {
+        hunks.append({0, n, 0, m});
+        return hunks;
+    }
+
+    // Walk back from the end and collect the matching lines
+    QVector<QPair<int, int>> matches;
+    int x = n;
+    int y = m;
+    for (int d = found; d > 0; --d) {
+        const QVector<int> &previous = trace.at(d - 1);
+        const auto previousX = [&previous, d](int k) {
+            return previous.at(k + d - 1);
+        };
+        const int k = x - y;
+        int previousK;
+        if (k == -d || (k != d && previousX(k - 1) < previousX(k + 1))) {
+            previousK = k + 1;
+        } else {
+            previousK = k - 1;
+        }
+        const int startX = previousX(previousK);
+        const int startY = startX - previousK;
+        // The diagonal following the insertion or removal of a line
+        const int midX = previousK == k + 1 ? startX : startX + 1;
+        const int midY = midX - k;
+        while (x > midX && y > midY) {
+            --x;
+            --y;
+            matches.append(qMakePair(x, y));
+        }
+        x = startX;
+        y = startY;
+    }
+    while (x > 0 && y > 0) {
+        --x;
+        --y;
+        matches.append(qMakePair(x, y));
+    }
+    std::reverse(matches.begin(), matches.end());
+
+    int oldPos = 0;
+    int newPos = 0;
+    for (const auto &match : qAsConst(matches)) {
+        if (match.first > oldPos || match.second > newPos) {
+            hunks.append({oldPos, match.first - oldPos, newPos, match.second - newPos});
+        }
+        oldPos = match.first + 1;
+        newPos = match.second + 1;
+    }
+    if (oldPos < n || newPos < m) {
+        hunks.append({oldPos, n - oldPos, newPos, m - newPos});
+    }
+    return hunks;
+}
+
+//@endcond
@@ -0,0 +1,66 @@
+/**
+ * Line diff
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+//@cond PRIVATE
+
+#include <QStringRef>
+#include <QVector>
+
+/**
+ * @short Computes the differing lines of two texts
+ *
+ * Uses the algorithm of Eugene W. Myers, "An O(ND) Difference Algorithm and
+ * Its Variations", on lines mapped to numbers, so that it takes time in the
+ * order of the number of lines times the number of differences. Common
+ * lines at the start and at the end should be stripped by the caller.
+ *
+ * @internal
+ */
+class LineDiff
+{
+public:
+    /**
+     * The lines oldStart to oldStart + oldCount - 1 of the old text are
+     * replaced by the lines newStart to newStart + newCount - 1 of the new
+     * text. One of the counts may be 0.
+     */
+    struct Hunk {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    /**
+     * Returns the hunks turning @p oldLines into @p newLines, ordered by
+     * their position. If more than @p maxEdits lines would have to be
+     * inserted or removed, a single hunk replacing everything is returned
+     * instead, as that is as fast to apply as the many small ones.
+     */
+    static QVector<Hunk> compute(const QVector<QStringRef> &oldLines, const QVector<QStringRef> &newLines, int maxEdits);
+};
+
+Q_DECLARE_TYPEINFO(LineDiff::Hunk, Q_PRIMITIVE_TYPE);
+
+//@endcond
+
+#endif
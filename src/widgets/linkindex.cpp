@@ -0,0 +1,191 @@
+/**
+ * Link index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "linkindex_p.h"
+
+#include <QTextBlock>
+#include <QTextEdit>
+
+#include <algorithm>
+
+//@cond PRIVATE
+
+LinkIndex::LinkIndex(QTextEdit *textEdit)
+    : m_textEdit(textEdit)
+{
+}
+
+LinkIndex::~LinkIndex()
+{
+    QObject::disconnect(m_connection);
+}
+
+QVector<LinkIndex::Entry> LinkIndex::entries()
+{
+    ensureIndex();
+    return m_entries;
+}
+
+QVector<LinkIndex::Entry> LinkIndex::entries(int from, int to)
+{
+    ensureIndex();
+    QVector<Entry> result;
+    for (auto it = firstEntryEndingAfter(from); it != m_entries.end() && it->start < to; ++it) {
+        result.append(*it);
+    }
+    return result;
+}
+
+const LinkIndex::Entry *LinkIndex::entryAt(int position)
+{
+    ensureIndex();
+    const auto it = firstEntryEndingAfter(position);
+    if (it != m_entries.end() && it->start <= position) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+QVector<LinkIndex::Entry>::iterator LinkIndex::firstEntryEndingAfter(int position)
+{
+    return std::partition_point(m_entries.begin(), m_entries.end(), [position](const Entry &entry) {
+        return entry.end <= position;
+    });
+}
+
+void LinkIndex::ensureIndex()
+{
+    QTextDocument *document = m_textEdit->document();
+    if (m_document == document) {
+        return;
+    }
+
+    // First use, or the text edit got another document
+    QObject::disconnect(m_connection);
+    m_document = document;
+    m_connection = QObject::connect(document, &QTextDocument::contentsChange, m_textEdit,
+    [this](int position, int charsRemoved, int charsAdded) {
+        contentsChange(position, charsRemoved, charsAdded);
+    });
+    m_entries.clear();
+    scan(document->begin(), document->characterCount(), &m_entries);
+}
+
+void LinkIndex::contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    QTextDocument *document = m_document;
+    if (document != m_textEdit->document()) {
+        // Rebuilt for the new document on next use
+        return;
+    }
+    if (charsAdded >= document->characterCount() - 1) {
+        // All text was replaced
+        m_entries.clear();
+        scan(document->begin(), document->characterCount(), &m_entries);
+        return;
+    }
+
+    // Drop the links in the changed text, and the ones right before or
+    // after it, which may now continue into it.
+    const int delta = charsAdded - charsRemoved;
+    const int oldEnd = position + charsRemoved;
+    int from = position;
+    int to = position + charsAdded;
+    auto first = firstEntryEndingAfter(position - 2);
+    auto last = first;
+    for (; last != m_entries.end() && last->start <= oldEnd + 1; ++last) {
+        from = qMin(from, last->start);
+        to = qMax(to, last->end <= position ? last->end : last->end + delta);
+    }
+    first = m_entries.erase(first, last);
+    for (auto it = first; it != m_entries.end(); ++it) {
+        it->start += delta;
+        it->end += delta;
+    }
+
+    // Scan whole blocks, together with the links reaching into them
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        const QTextBlock fromBlock = document->findBlock(from);
+        QTextBlock toBlock = document->findBlock(to);
+        if (!toBlock.isValid()) {
+            toBlock = document->lastBlock();
+        }
+        from = fromBlock.position();
+        to = toBlock.position() + toBlock.length() - 1;
+
+        first = firstEntryEndingAfter(from - 2);
+        for (last = first; last != m_entries.end() && last->start <= to + 1; ++last) {
+            if (last->start < from || last->end > to) {
+                from = qMin(from, last->start);
+                to = qMax(to, last->end);
+                grown = true;
+            }
+        }
+        first = m_entries.erase(first, last);
+    }
+
+    QVector<Entry> scanned;
+    scan(document->findBlock(from), to + 1, &scanned);
+    const int index = first - m_entries.begin();
+    m_entries.insert(index, scanned.size(), Entry());
+    std::copy(scanned.cbegin(), scanned.cend(), m_entries.begin() + index);
+}
+
+void LinkIndex::scan(QTextBlock block, int to, QVector<Entry> *entries) const
+{
+    Entry run = {-1, -1, QString()};
+    for (; block.isValid(); block = block.next()) {
+        // A link only continues into this block from the end of the previous one
+        if (run.start != -1 && run.end != block.position() - 1) {
+            entries->append(run);
+            run.start = -1;
+        }
+        if (block.position() >= to && run.start == -1) {
+            return;
+        }
+
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            const QTextFragment fragment = it.fragment();
+            const QTextCharFormat format = fragment.charFormat();
+            const QString href = format.isAnchor() ? format.anchorHref() : QString();
+            if (run.start != -1) {
+                if (href == run.href && (fragment.position() == run.end || fragment.position() == block.position())) {
+                    run.end = fragment.position() + fragment.length();
+                    continue;
+                }
+                entries->append(run);
+                run.start = -1;
+                if (block.position() >= to) {
+                    // Only scanned for the continued link
+                    return;
+                }
+            }
+            if (!href.isEmpty()) {
+                run = {fragment.position(), fragment.position() + fragment.length(), href};
+            }
+        }
+    }
+    if (run.start != -1) {
+        entries->append(run);
+    }
+}
+
+//@endcond
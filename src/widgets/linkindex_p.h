@@ -0,0 +1,92 @@
+/**
+ * Link index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef LINKINDEX_H
+#define LINKINDEX_H
+
+//@cond PRIVATE
+
+#include <QMetaObject>
+#include <QPointer>
+#include <QString>
+#include <QTextDocument>
+#include <QVector>
+
+class QTextBlock;
+class QTextEdit;
+
+/**
+ * @short Index of the links in the document of a text edit
+ *
+ * The index is built from the character formats of the document on first
+ * use. Afterwards it follows the contentsChange() signal of the document and
+ * only scans the blocks which were changed, so it stays cheap to keep while
+ * typing. A link continuing from the end of one block into the start of the
+ * next is one entry.
+ *
+ * The entries are sorted by position and do not overlap, so the link at a
+ * position is found by a binary search.
+ *
+ * @internal
+ */
+class LinkIndex
+{
+public:
+    struct Entry {
+        int start;
+        int end;
+        QString href;
+    };
+
+    explicit LinkIndex(QTextEdit *textEdit);
+    ~LinkIndex();
+
+    /**
+     * Returns all links of the document.
+     */
+    QVector<Entry> entries();
+
+    /**
+     * Returns the links with at least one character between @p from and @p to.
+     */
+    QVector<Entry> entries(int from, int to);
+
+    /**
+     * Returns the link containing the character at @p position, or nullptr.
+     * The pointer is valid until the document changes.
+     */
+    const Entry *entryAt(int position);
+
+private:
+    void ensureIndex();
+    void contentsChange(int position, int charsRemoved, int charsAdded);
+    void scan(QTextBlock block, int to, QVector<Entry> *entries) const;
+    QVector<Entry>::iterator firstEntryEndingAfter(int position);
+
+    QTextEdit *m_textEdit;
+    QPointer<QTextDocument> m_document;
+    QMetaObject::Connection m_connection;
+    QVector<Entry> m_entries;
+};
+
+Q_DECLARE_TYPEINFO(LinkIndex::Entry, Q_MOVABLE_TYPE);
+
+//@endcond
+
+#endif
@@ -0,0 +1,781 @@
+/**
+ * Markdown helper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "markdownhelper_p.h"
+
+#include <algorithm>
+
+#include <QHash>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextList>
+#include <QVector>
+
+//@cond PRIVATE
+
+// Qt's HTML importer maps <h1> to <h6> to these font size adjustments.
+static int headingSizeAdjustment(int level)
+{
+    return 4 - level;
+}
+
+static bool isOrderedStyle(QTextListFormat::Style style)
+{
+    return style <= QTextListFormat::ListDecimal;
+}
+
+static QTextCharFormat codeCharFormat()
+{
+    QTextCharFormat format;
+    format.setFontFamily(QStringLiteral("monospace"));
+    format.setFontFixedPitch(true);
+    return format;
+}
+
+static bool isHorizontalRule(const QString &line)
+{
+    const QChar ruleChar = line.at(0);
+    if (ruleChar != QLatin1Char('-') && ruleChar != QLatin1Char('*') && ruleChar != QLatin1Char('_')) {
+        return false;
+    }
+    int count = 0;
+    for (const QChar c : line) {
+        if (c == ruleChar) {
+            ++count;
+        } else if (!c.isSpace()) {
+            return false;
+        }
+    }
+    return count >= 3;
+}
+
+class MarkdownImporter
+{
+public:
+    MarkdownImporter(QTextDocument *document, const QTextCharFormat &linkFormat)
+        : cursor(document),
+          linkFormat(linkFormat)
+    {
+    }
+
+    void import(const QString &markdown);
+
+private:
+    void parseLine(const QString &line);
+    bool parseListItem(const QString &trimmed, int column);
+    void startBlock(const QTextBlockFormat &blockFormat, const QTextCharFormat &charFormat = QTextCharFormat());
+    void appendParagraphLine(QString line);
+    void finishParagraph();
+    void insertInline(const QString &text);
+    void appendRun(const QString &text, const QTextCharFormat &format);
+    void flushRun();
+
+    struct ListLevel {
+        int column;
+        bool ordered;
+        QTextList *list;
+    };
+
+    QTextCursor cursor;
+    const QTextCharFormat linkFormat;
+    QVector<ListLevel> lists;
+
+    bool firstBlock = true;
+    bool paragraphOpen = false;
+    bool hardBreak = false;
+    int quoteLevel = 0;
+    QString paragraph;
+    QTextCharFormat paragraphCharFormat;
+
+    bool inFence = false;
+    QString fence;
+
+    QString runText;
+    QTextCharFormat runFormat;
+};
+
+void MarkdownImporter::import(const QString &markdown)
+{
+    cursor.beginEditBlock();
+    int start = 0;
+    const int length = markdown.length();
+    while (start <= length) {
+        int end = markdown.indexOf(QLatin1Char('\n'), start);
+        if (end < 0) {
+            end = length;
+        }
+        int lineEnd = end;
+        if (lineEnd > start && markdown.at(lineEnd - 1) == QLatin1Char('\r')) {
+            --lineEnd;
+        }
+        parseLine(markdown.mid(start, lineEnd - start));
+        start = end + 1;
+    }
+    finishParagraph();
+    cursor.endEditBlock();
+}
+
+void MarkdownImporter::parseLine(const QString &line)
+{
+    const QString trimmed = line.trimmed();
+
+    if (inFence) {
+        if (trimmed.startsWith(fence)) {
+            inFence = false;
+            return;
+        }
+        QTextBlockFormat codeFormat;
+        codeFormat.setNonBreakableLines(true);
+        startBlock(codeFormat, codeCharFormat());
+        QString code = line;
+        code.replace(QLatin1Char('\t'), QLatin1String("    "));
+        if (!code.isEmpty()) {
+            cursor.insertText(code, codeCharFormat());
+        }
+        return;
+    }
+
+    if (trimmed.isEmpty()) {
+        finishParagraph();
+        quoteLevel = 0;
+        return;
+    }
+
+    int column = 0;
+    for (const QChar c : line) {
+        if (c == QLatin1Char(' ')) {
+            ++column;
+        } else if (c == QLatin1Char('\t')) {
+            column += 4;
+        } else {
+            break;
+        }
+    }
+
+    if (trimmed.startsWith(QLatin1String("```")) || trimmed.startsWith(QLatin1String("~~~"))) {
+        finishParagraph();
+        lists.clear();
+        inFence = true;
+        fence = trimmed.left(3);
+        return;
+    }
+
+    if (trimmed.at(0) == QLatin1Char('#')) {
+        int level = 0;
+        while (level < trimmed.length() && trimmed.at(level) == QLatin1Char('#')) {
+            ++level;
+        }
+        if (level <= 6 && (level == trimmed.length() || trimmed.at(level) == QLatin1Char(' '))) {
+            finishParagraph();
+            lists.clear();
+            QString title = trimmed.mid(level).trimmed();
+            while (title.endsWith(QLatin1Char('#'))) {
+                title.chop(1);
+            }
+            QTextBlockFormat headingFormat;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+            headingFormat.setHeadingLevel(level);
+#endif
+            QTextCharFormat headingCharFormat;
+            headingCharFormat.setFontWeight(QFont::Bold);
+            headingCharFormat.setProperty(QTextFormat::FontSizeAdjustment, headingSizeAdjustment(level));
+            startBlock(headingFormat, headingCharFormat);
+            paragraphCharFormat = headingCharFormat;
+            insertInline(title.trimmed());
+            flushRun();
+            paragraphCharFormat = QTextCharFormat();
+            return;
+        }
+    }
+
+    if (isHorizontalRule(trimmed)) {
+        finishParagraph();
+        lists.clear();
+        QTextBlockFormat ruleFormat;
+        ruleFormat.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth,
+                               QTextLength(QTextLength::PercentageLength, 100));
+        startBlock(ruleFormat);
+        return;
+    }
+
+    if (parseListItem(trimmed, column)) {
+        return;
+    }
+
+    if (trimmed.at(0) == QLatin1Char('>')) {
+        int level = 0;
+        int pos = 0;
+        while (pos < trimmed.length() && (trimmed.at(pos) == QLatin1Char('>') || trimmed.at(pos) == QLatin1Char(' '))) {
+            if (trimmed.at(pos) == QLatin1Char('>')) {
+                ++level;
+            }
+            ++pos;
+        }
+        if (!paragraphOpen || level != quoteLevel) {
+            finishParagraph();
+            lists.clear();
+            quoteLevel = level;
+            QTextBlockFormat quoteFormat;
+            quoteFormat.setIndent(level);
+            startBlock(quoteFormat);
+            paragraphOpen = true;
+        }
+        appendParagraphLine(line.mid(line.indexOf(trimmed) + pos));
+        return;
+    }
+
+    if (!paragraphOpen) {
+        // An indented paragraph continues a list item. Keep the lists open
+        // so that numbering continues with the next item.
+        if (lists.isEmpty() || column < lists.first().column + 2) {
+            lists.clear();
+        }
+        startBlock(QTextBlockFormat());
+        paragraphOpen = true;
+    }
+    appendParagraphLine(line);
+}
+
+bool MarkdownImporter::parseListItem(const QString &trimmed, int column)
+{
+    int markerLength = 0;
+    bool ordered = false;
+    const QChar first = trimmed.at(0);
+    if (first == QLatin1Char('-') || first == QLatin1Char('*') || first == QLatin1Char('+')) {
+        markerLength = 1;
+    } else if (first.isDigit()) {
+        int pos = 1;
+        while (pos < trimmed.length() && pos < 10 && trimmed.at(pos).isDigit()) {
+            ++pos;
+        }
+        if (pos < trimmed.length() && (trimmed.at(pos) == QLatin1Char('.') || trimmed.at(pos) == QLatin1Char(')'))) {
+            markerLength = pos + 1;
+            ordered = true;
+        }
+    }
+    if (markerLength == 0 || (markerLength < trimmed.length() && trimmed.at(markerLength) != QLatin1Char(' '))) {
+        return false;
+    }
+
+    finishParagraph();
+    quoteLevel = 0;
+
+    while (!lists.isEmpty() && lists.last().column > column) {
+        lists.removeLast();
+    }
+    const bool nested = lists.isEmpty() || column >= lists.last().column + 2;
+    if (!nested && lists.last().ordered != ordered) {
+        lists.removeLast();
+    }
+
+    startBlock(QTextBlockFormat());
+    if (!nested && !lists.isEmpty()) {
+        lists.last().list->add(cursor.block());
+    } else {
+        QTextListFormat listFormat;
+        listFormat.setIndent(lists.count() + 1);
+        if (ordered) {
+            listFormat.setStyle(QTextListFormat::ListDecimal);
+        } else {
+            static const QTextListFormat::Style bulletStyles[] = {
+                QTextListFormat::ListDisc, QTextListFormat::ListCircle, QTextListFormat::ListSquare
+            };
+            listFormat.setStyle(bulletStyles[qMin(lists.count(), 2)]);
+        }
+        const ListLevel level = { column, ordered, cursor.createList(listFormat) };
+        lists.append(level);
+    }
+
+    paragraphOpen = true;
+    appendParagraphLine(trimmed.mid(markerLength));
+    return true;
+}
+
+void MarkdownImporter::startBlock(const QTextBlockFormat &blockFormat, const QTextCharFormat &charFormat)
+{
+    if (firstBlock) {
+        cursor.setBlockFormat(blockFormat);
+        cursor.setBlockCharFormat(charFormat);
+        firstBlock = false;
+    } else {
+        cursor.insertBlock(blockFormat, charFormat);
+    }
+}
+
+void MarkdownImporter::appendParagraphLine(QString line)
+{
+    if (!paragraph.isEmpty()) {
+        paragraph += hardBreak ? QChar(QChar::LineSeparator) : QLatin1Char(' ');
+    }
+    hardBreak = false;
+    if (line.endsWith(QLatin1String("  "))) {
+        hardBreak = true;
+    } else if (line.endsWith(QLatin1Char('\\'))) {
+        line.chop(1);
+        hardBreak = true;
+    }
+    paragraph += line.trimmed();
+}
+
+void MarkdownImporter::finishParagraph()
+{
+    if (!paragraphOpen) {
+        return;
+    }
+    insertInline(paragraph);
+    flushRun();
+    paragraph.clear();
+    paragraphOpen = false;
+    hardBreak = false;
+}
+
+void MarkdownImporter::insertInline(const QString &text)
+{
+    bool bold = false;
+    bool italic = false;
+    bool strikeOut = false;
+    QString href;
+    int linkTextEnd = -1;
+    int linkEnd = -1;
+
+    const auto currentFormat = [&]() {
+        QTextCharFormat format = paragraphCharFormat;
+        if (bold) {
+            format.setFontWeight(QFont::Bold);
+        }
+        if (italic) {
+            format.setFontItalic(true);
+        }
+        if (strikeOut) {
+            format.setFontStrikeOut(true);
+        }
+        if (!href.isEmpty()) {
+            format.merge(linkFormat);
+            format.setAnchor(true);
+            format.setAnchorHref(href);
+        }
+        return format;
+    };
+
+    const int length = text.length();
+    int i = 0;
+    while (i < length) {
+        const QChar c = text.at(i);
+
+        if (linkTextEnd != -1 && i >= linkTextEnd) {
+            href.clear();
+            linkTextEnd = -1;
+            i = linkEnd + 1;
+            continue;
+        }
+        // Escapes and code spans do not reach beyond the text of a link
+        const int limit = linkTextEnd != -1 ? linkTextEnd : length;
+
+        if (c == QLatin1Char('\\') && i + 1 < limit && text.at(i + 1).isPunct()) {
+            appendRun(text.at(i + 1), currentFormat());
+            i += 2;
+            continue;
+        }
+
+        if (c == QLatin1Char('`')) {
+            int ticks = 1;
+            while (i + ticks < length && text.at(i + ticks) == QLatin1Char('`')) {
+                ++ticks;
+            }
+            const int close = text.indexOf(QString(ticks, QLatin1Char('`')), i + ticks);
+            if (close > 0 && close + ticks <= limit) {
+                QTextCharFormat format = currentFormat();
+                format.merge(codeCharFormat());
+                appendRun(text.mid(i + ticks, close - i - ticks).trimmed(), format);
+                i = close + ticks;
+                continue;
+            }
+            appendRun(text.mid(i, ticks), currentFormat());
+            i += ticks;
+            continue;
+        }
+
+        if (c == QLatin1Char('[') && href.isEmpty()) {
+            // An escaped bracket does not end the link text
+            int textEnd = i + 1;
+            while (textEnd < length && text.at(textEnd) != QLatin1Char(']')) {
+                textEnd += text.at(textEnd) == QLatin1Char('\\') ? 2 : 1;
+            }
+            if (textEnd + 1 < length && text.at(textEnd + 1) == QLatin1Char('(')) {
+                const int end = text.indexOf(QLatin1Char(')'), textEnd + 2);
+                if (end > 0) {
+                    // Drop an optional link title
+                    href = text.mid(textEnd + 2, end - textEnd - 2).trimmed().section(QLatin1Char(' '), 0, 0);
+                    if (!href.isEmpty()) {
+                        linkTextEnd = textEnd;
+                        linkEnd = end;
+                        ++i;
+                        continue;
+                    }
+                }
+            }
+        }
+
+        if (c == QLatin1Char('*') || c == QLatin1Char('_') || c == QLatin1Char('~')) {
+            int count = 1;
+            while (i + count < length && text.at(i + count) == c) {
+                ++count;
+            }
+            const int width = (c == QLatin1Char('~') || count >= 2) ? 2 : 1;
+            bool &state = c == QLatin1Char('~') ? strikeOut : (width == 2 ? bold : italic);
+            const QChar before = i > 0 ? text.at(i - 1) : QChar(QLatin1Char(' '));
+            const QChar after = i + width < length ? text.at(i + width) : QChar(QLatin1Char(' '));
+            // Underscores only delimit emphasis at word boundaries, not in snake_case.
+            const bool intraword = c == QLatin1Char('_') && before.isLetterOrNumber() && after.isLetterOrNumber();
+            if (count >= width && !intraword) {
+                if (state && !before.isSpace()) {
+                    state = false;
+                    i += width;
+                    continue;
+                }
+                if (!state && !after.isSpace() && text.indexOf(QString(width, c), i + width + 1) > 0) {
+                    state = true;
+                    i += width;
+                    continue;
+                }
+            }
+            appendRun(text.mid(i, count), currentFormat());
+            i += count;
+            continue;
+        }
+
+        int end = i + 1;
+        while (end < length && end != linkTextEnd) {
+            const QChar next = text.at(end);
+            if (next == QLatin1Char('\\') || next == QLatin1Char('`') || next == QLatin1Char('[')
+                    || next == QLatin1Char('*') || next == QLatin1Char('_') || next == QLatin1Char('~')) {
+                break;
+            }
+            ++end;
+        }
+        appendRun(text.mid(i, end - i), currentFormat());
+        i = end;
+    }
+}
+
+void MarkdownImporter::appendRun(const QString &text, const QTextCharFormat &format)
+{
+    if (format != runFormat) {
+        flushRun();
+        runFormat = format;
+    }
+    runText += text;
+}
+
+void MarkdownImporter::flushRun()
+{
+    if (!runText.isEmpty()) {
+        cursor.insertText(runText, runFormat);
+        runText.clear();
+    }
+}
+
+class MarkdownExporter
+{
+public:
+    explicit MarkdownExporter(const QTextDocument *document)
+        : document(document)
+    {
+    }
+
+    QString exportMarkdown();
+
+private:
+    struct Run {
+        QString text;
+        QString href;
+        bool bold;
+        bool italic;
+        bool strikeOut;
+        bool code;
+    };
+
+    QString inlineMarkdown(const QTextBlock &block, bool heading, const QString &lineBreak) const;
+    static void appendRun(QString &out, const Run &run);
+    static QString escaped(const QString &text);
+
+    const QTextDocument *document;
+    QHash<QTextList *, int> itemNumbers;
+};
+
+QString MarkdownExporter::exportMarkdown()
+{
+    enum Previous { None, Paragraph, ListItem, Code };
+
+    QString out;
+    out.reserve(document->characterCount() + document->characterCount() / 8);
+    Previous previous = None;
+
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        const QTextBlockFormat blockFormat = block.blockFormat();
+        QTextList *list = block.textList();
+
+        if (blockFormat.nonBreakableLines() && !list) {
+            if (previous != Code) {
+                if (previous != None) {
+                    out += QLatin1Char('\n');
+                }
+                out += QLatin1String("```\n");
+            }
+            QString code = block.text();
+            code.replace(QChar::LineSeparator, QLatin1Char('\n'));
+            out += code + QLatin1Char('\n');
+            previous = Code;
+            continue;
+        }
+        if (previous == Code) {
+            out += QLatin1String("```\n");
+            previous = Paragraph;
+        }
+
+        if (list) {
+            if (previous == Paragraph) {
+                out += QLatin1Char('\n');
+            }
+            const QString indentation(4 * qMax(0, list->format().indent() - 1), QLatin1Char(' '));
+            out += indentation;
+            const int number = ++itemNumbers[list];
+            if (isOrderedStyle(list->format().style())) {
+                out += QString::number(number) + QLatin1String(". ");
+            } else {
+                out += QLatin1String("- ");
+            }
+            out += inlineMarkdown(block, false, QLatin1String("  \n    ") + indentation) + QLatin1Char('\n');
+            previous = ListItem;
+            continue;
+        }
+
+        if (block.length() <= 1 && !blockFormat.hasProperty(QTextFormat::BlockTrailingHorizontalRulerWidth)) {
+            // Empty paragraphs only separate blocks in Markdown
+            continue;
+        }
+        if (previous != None) {
+            out += QLatin1Char('\n');
+        }
+        previous = Paragraph;
+
+        if (blockFormat.hasProperty(QTextFormat::BlockTrailingHorizontalRulerWidth)) {
+            out += QLatin1String("---\n");
+            continue;
+        }
+
+        int headingLevel = 0;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        headingLevel = blockFormat.headingLevel();
+#endif
+        if (headingLevel == 0 && block.begin() != block.end()) {
+            const QTextCharFormat firstFormat = block.begin().fragment().charFormat();
+            const int adjustment = firstFormat.intProperty(QTextFormat::FontSizeAdjustment);
+            if (adjustment > 0 && firstFormat.fontWeight() > QFont::Normal) {
+                headingLevel = 4 - adjustment;
+            }
+        }
+        if (headingLevel > 0) {
+            out += QString(headingLevel, QLatin1Char('#')) + QLatin1Char(' ')
+                   + inlineMarkdown(block, true, QLatin1String(" ")) + QLatin1Char('\n');
+            continue;
+        }
+
+        QString quote;
+        for (int i = 0; i < blockFormat.indent(); ++i) {
+            quote += QLatin1String("> ");
+        }
+        QString text = inlineMarkdown(block, false, QLatin1String("  \n") + quote);
+        if (quote.isEmpty() && !text.isEmpty()) {
+            // Keep paragraphs from turning into headings, quotes or list items
+            const QChar first = text.at(0);
+            if (first == QLatin1Char('#') || first == QLatin1Char('>') || first == QLatin1Char('-') || first == QLatin1Char('+')) {
+                text.prepend(QLatin1Char('\\'));
+            } else if (first.isDigit()) {
+                int pos = 1;
+                while (pos < text.length() && text.at(pos).isDigit()) {
+                    ++pos;
+                }
+                if (pos < text.length() && (text.at(pos) == QLatin1Char('.') || text.at(pos) == QLatin1Char(')'))) {
+                    text.insert(pos, QLatin1Char('\\'));
+                }
+            }
+        }
+        out += quote + text + QLatin1Char('\n');
+    }
+
+    if (previous == Code) {
+        out += QLatin1String("```\n");
+    }
+    return out;
+}
+
+QString MarkdownExporter::inlineMarkdown(const QTextBlock &block, bool heading, const QString &lineBreak) const
+{
+    QString out;
+    QString currentHref;
+    Run run = { QString(), QString(), false, false, false, false };
+
+    const auto flush = [&]() {
+        if (run.text.isEmpty()) {
+            return;
+        }
+        if (run.href != currentHref) {
+            if (!currentHref.isEmpty()) {
+                out += QLatin1String("](") + currentHref + QLatin1Char(')');
+            }
+            if (!run.href.isEmpty()) {
+                out += QLatin1Char('[');
+            }
+            currentHref = run.href;
+        }
+        appendRun(out, run);
+        run.text.clear();
+    };
+
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        const QTextFragment fragment = it.fragment();
+        if (!fragment.isValid()) {
+            continue;
+        }
+        const QTextCharFormat format = fragment.charFormat();
+        QString text = fragment.text();
+        text.remove(QChar::ObjectReplacementCharacter);
+        if (text.isEmpty()) {
+            continue;
+        }
+
+        QString href;
+        if (format.isAnchor()) {
+            href = format.anchorHref();
+            href.replace(QLatin1Char(' '), QLatin1String("%20"));
+            href.replace(QLatin1Char(')'), QLatin1String("%29"));
+        }
+        const bool code = format.fontFixedPitch();
+        const bool bold = !heading && !code && format.fontWeight() > QFont::Normal;
+        const bool italic = !code && format.fontItalic();
+        const bool strikeOut = !code && format.fontStrikeOut();
+        if (href != run.href || bold != run.bold || italic != run.italic || strikeOut != run.strikeOut || code != run.code) {
+            flush();
+            run.href = href;
+            run.bold = bold;
+            run.italic = italic;
+            run.strikeOut = strikeOut;
+            run.code = code;
+        }
+        run.text += text;
+    }
+    flush();
+    if (!currentHref.isEmpty()) {
+        out += QLatin1String("](") + currentHref + QLatin1Char(')');
+    }
+
+    out.replace(QChar::LineSeparator, lineBreak);
+    return out;
+}
+
+void MarkdownExporter::appendRun(QString &out, const Run &run)
+{
+    if (run.code) {
+        const QString ticks = run.text.contains(QLatin1Char('`')) ? QStringLiteral("``") : QStringLiteral("`");
+        const QString padding = run.text.startsWith(QLatin1Char('`')) || run.text.endsWith(QLatin1Char('`'))
+                                ? QStringLiteral(" ") : QString();
+        out += ticks + padding + run.text + padding + ticks;
+        return;
+    }
+
+    QString marker;
+    if (run.bold) {
+        marker += QLatin1String("**");
+    }
+    if (run.italic) {
+        marker += QLatin1Char('*');
+    }
+    if (run.strikeOut) {
+        marker += QLatin1String("~~");
+    }
+
+    const QString text = escaped(run.text);
+    if (marker.isEmpty()) {
+        out += text;
+        return;
+    }
+
+    // Delimiters must not be adjacent to whitespace on the inner side
+    int start = 0;
+    while (start < text.length() && text.at(start).isSpace()) {
+        ++start;
+    }
+    int end = text.length();
+    while (end > start && text.at(end - 1).isSpace()) {
+        --end;
+    }
+    if (start == end) {
+        out += text;
+        return;
+    }
+    QString closing = marker;
+    std::reverse(closing.begin(), closing.end());
+    out += text.left(start) + marker + text.mid(start, end - start) + closing + text.mid(end);
+}
+
+QString MarkdownExporter::escaped(const QString &text)
+{
+    QString result;
+    result.reserve(text.length());
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+        case '\\':
+        case '*':
+        case '_':
+        case '`':
+        case '[':
+        case ']':
+        case '~':
+            result += QLatin1Char('\\');
+            break;
+        default:
+            break;
+        }
+        result += c;
+    }
+    return result;
+}
+
+void MarkdownHelper::importMarkdown(QTextDocument *document, const QString &markdown, const QTextCharFormat &linkFormat)
+{
+    // Nothing built here needs to be undone, so skip recording it.
+    const bool undoRedoEnabled = document->isUndoRedoEnabled();
+    document->setUndoRedoEnabled(false);
+    document->clear();
+
+    MarkdownImporter importer(document, linkFormat);
+    importer.import(markdown);
+
+    document->setUndoRedoEnabled(undoRedoEnabled);
+}
+
+QString MarkdownHelper::exportMarkdown(const QTextDocument *document)
+{
+    MarkdownExporter exporter(document);
+    return exporter.exportMarkdown();
+}
+
+//@endcond
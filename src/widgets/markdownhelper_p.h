@@ -0,0 +1,67 @@
+/**
+ * Markdown helper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef MARKDOWNHELPER_H
+#define MARKDOWNHELPER_H
+
+//@cond PRIVATE
+
+#include <QTextCharFormat>
+
+class QString;
+class QTextDocument;
+
+/**
+ * @short Helper class to convert between Markdown and QTextDocument content
+ *
+ * The importer reads the Markdown source line by line and appends the
+ * result to the document with one QTextCursor inside a single edit block,
+ * inserting one run of text per change of character format. No HTML and no
+ * intermediate syntax tree is built.
+ *
+ * The supported subset is the one commonly used in mails: ATX headings,
+ * paragraphs, hard line breaks, block quotes, fenced code blocks, horizontal
+ * rules, nested ordered and unordered lists, emphasis, strong emphasis,
+ * strike out, code spans and inline links.
+ *
+ * @internal
+ */
+class MarkdownHelper
+{
+public:
+    /**
+     * Replaces the content of @p document with the Markdown text @p markdown.
+     * The undo stack of the document is cleared.
+     *
+     * @param linkFormat This format is merged into the format of link texts.
+     */
+    static void importMarkdown(QTextDocument *document, const QString &markdown,
+                               const QTextCharFormat &linkFormat = QTextCharFormat());
+
+    /**
+     * Returns the content of @p document as Markdown text. Nested lists are
+     * written according to the indent of their list format, as created by
+     * NestedListHelper.
+     */
+    static QString exportMarkdown(const QTextDocument *document);
+};
+
+//@endcond
+
+#endif
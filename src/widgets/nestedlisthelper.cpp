@@ -21,10 +21,13 @@
 
 #include "nestedlisthelper_p.h"
 
+#include <QHash>
 #include <QKeyEvent>
+#include <QSet>
 #include <QTextCursor>
 #include <QTextList>
 #include <QTextBlock>
+#include <QVector>
 
 #include "ktextedit.h"
 
@@ -167,51 +170,47 @@ bool NestedListHelper::handleAfterDropEvent(QDropEvent *dropEvent)
     return true;
 }
 
-void NestedListHelper::processList(QTextList *list)
+void NestedListHelper::reformatList(QTextBlock block)
 {
-    QTextBlock block = list->item(0);
-    int thisListIndent = list->format().indent();
-
-    QTextCursor cursor = QTextCursor(block);
-    list = cursor.createList(list->format());
-    bool processingSubList  = false;
-    while (block.next().textList() != nullptr) {
-        block = block.next();
-
-        QTextList *nextList = block.textList();
-        int nextItemIndent = nextList->format().indent();
-        if (nextItemIndent < thisListIndent) {
-            return;
-        } else if (nextItemIndent > thisListIndent) {
-            if (processingSubList) {
-                continue;
-            }
-            processingSubList = true;
-            processList(nextList);
-        } else {
-            processingSubList = false;
-            list->add(block);
-        }
+    if (!block.textList()) {
+        return;
     }
-//     delete nextList;
-//     nextList = 0;
-}
 
-void NestedListHelper::reformatList(QTextBlock block)
-{
-    if (block.textList()) {
-        int minimumIndent =  block.textList()->format().indent();
+    // Start at the top of the consecutive list items
+    while (block.previous().textList()) {
+        block = block.previous();
+    }
 
-        // Start at the top of the list
-        while (block.previous().textList() != nullptr) {
-            if (block.previous().textList()->format().indent() < minimumIndent) {
-                break;
+    // Consecutive items on the same level, only separated by items of
+    // sublists, belong to one list. Walk the items once, keeping the list of
+    // each open level on a stack, and only move the items which are in
+    // another list.
+    struct Level {
+        int indent;
+        QTextList *list;
+    };
+    QVector<Level> levels;
+    QSet<QTextList *> usedLists;
+    for (; block.isValid() && block.textList(); block = block.next()) {
+        QTextList *list = block.textList();
+        const int indent = list->format().indent();
+        while (!levels.isEmpty() && levels.last().indent > indent) {
+            levels.removeLast();
+        }
+        if (!levels.isEmpty() && levels.last().indent == indent) {
+            if (list != levels.last().list) {
+                levels.last().list->add(block);
             }
-            block = block.previous();
+        } else if (!usedLists.contains(list)) {
+            levels.append({indent, list});
+            usedLists.insert(list);
+        } else {
+            // The list is already used by an earlier run, start a new one
+            QTextCursor cursor(block);
+            QTextList *newList = cursor.createList(list->format());
+            levels.append({indent, newList});
+            usedLists.insert(newList);
         }
-
-        processList(block.textList());
-
     }
 }
 
@@ -241,11 +240,67 @@ QTextCursor NestedListHelper::bottomOfSelection()
     return cursor;
 }
 
+QVector<QTextBlock> NestedListHelper::selectedBlocks()
+{
+    QVector<QTextBlock> blocks;
+    const QTextBlock last = bottomOfSelection().block();
+    for (QTextBlock block = topOfSelection().block(); block.isValid(); block = block.next()) {
+        blocks.append(block);
+        if (block == last) {
+            break;
+        }
+    }
+    return blocks;
+}
+
+void NestedListHelper::changeIndent(int delta)
+{
+    // Find the new nesting level of all selected list items first
+    struct Change {
+        QTextBlock block;
+        QTextList *list;
+        QTextListFormat format;
+    };
+    QVector<Change> changes;
+    const QVector<QTextBlock> blocks = selectedBlocks();
+    for (const QTextBlock &block : blocks) {
+        if (QTextList *list = block.textList()) {
+            QTextListFormat format = list->format();
+            format.setIndent(format.indent() + delta);
+            changes.append({block, list, format});
+        }
+    }
+
+    // The items of one list move to a single list on their new level. The
+    // old lists are only used as keys, they may be gone once empty.
+    QHash<QTextList *, QTextList *> newLists;
+    for (const Change &change : qAsConst(changes)) {
+        if (change.format.indent() < 1) {
+            QTextBlockFormat bfmt;
+            bfmt.setObjectIndex(-1);
+            QTextCursor(change.block).setBlockFormat(bfmt);
+        } else if (QTextList *newList = newLists.value(change.list)) {
+            newList->add(change.block);
+        } else {
+            QTextCursor cursor(change.block);
+            newLists.insert(change.list, cursor.createList(change.format));
+        }
+    }
+
+    // Removing items may have split the list, reformat every part once
+    for (const QTextBlock &block : blocks) {
+        if (block == blocks.first() || !block.previous().textList()) {
+            reformatList(block);
+        }
+    }
+    reformatList(blocks.last().next());
+}
+
 void NestedListHelper::handleOnIndentMore()
 {
     QTextCursor cursor = textEdit->textCursor();
+    cursor.beginEditBlock();
 
-    QTextListFormat listFmt;
     if (!cursor.currentList()) {
 
         QTextListFormat::Style style;
@@ -266,67 +321,60 @@ void NestedListHelper::handleOnIndentMore()
         }
         handleOnBulletType(style);
     } else {
-        listFmt = cursor.currentList()->format();
-        listFmt.setIndent(listFmt.indent() + 1);
-
-        cursor.createList(listFmt);
-        reformatList();
+        changeIndent(1);
     }
 
     reformatBoundingItemSpacing();
+    cursor.endEditBlock();
 }
 
 void NestedListHelper::handleOnIndentLess()
 {
     QTextCursor cursor = textEdit->textCursor();
-    QTextList *currentList = cursor.currentList();
-    if (!currentList) {
+    if (!cursor.currentList()) {
         return;
     }
-    QTextListFormat listFmt;
-    listFmt = currentList->format();
-    if (listFmt.indent() > 1) {
-        listFmt.setIndent(listFmt.indent() - 1);
-        cursor.createList(listFmt);
-        reformatList(cursor.block());
-    } else {
-        QTextBlockFormat bfmt;
-        bfmt.setObjectIndex(-1);
-        cursor.setBlockFormat(bfmt);
-        reformatList(cursor.block().next());
-    }
+    cursor.beginEditBlock();
+    changeIndent(-1);
     reformatBoundingItemSpacing();
+    cursor.endEditBlock();
 }
 
 void NestedListHelper::handleOnBulletType(int styleIndex)
 {
     QTextCursor cursor = textEdit->textCursor();
+    cursor.beginEditBlock();
+
     if (styleIndex != 0) {
         QTextListFormat::Style style = static_cast<QTextListFormat::Style>(styleIndex);
-        QTextList *currentList = cursor.currentList();
         QTextListFormat listFmt;
 
-        cursor.beginEditBlock();
-
-        if (currentList) {
-            listFmt = currentList->format();
-            listFmt.setStyle(style);
-            currentList->setFormat(listFmt);
+        if (cursor.currentList()) {
+            // Change the style of every list in the selection
+            QSet<QTextList *> lists;
+            const QVector<QTextBlock> blocks = selectedBlocks();
+            for (const QTextBlock &block : blocks) {
+                QTextList *list = block.textList();
+                if (list && !lists.contains(list)) {
+                    lists.insert(list);
+                    listFmt = list->format();
+                    listFmt.setStyle(style);
+                    list->setFormat(listFmt);
+                }
+            }
         } else {
             listFmt.setStyle(style);
             cursor.createList(listFmt);
         }
-
-        cursor.endEditBlock();
     } else {
         QTextBlockFormat bfmt;
         bfmt.setObjectIndex(-1);
         cursor.setBlockFormat(bfmt);
-        reformatBoundingItemSpacing();
     }
 
     reformatBoundingItemSpacing();
     reformatList();
+    cursor.endEditBlock();
 }
 
 void NestedListHelper::reformatBoundingItemSpacing(QTextBlock block)
@@ -24,6 +24,8 @@
 
 //@cond PRIVATE
 
+#include <QVector>
+
 class QTextEdit;
 
 class QKeyEvent;
@@ -86,17 +88,23 @@ public:
 
     /**
      * Increases the indent (nesting level) on the current list item or selection.
+     *
+     * All list items in the selection are changed in one edit block, so
+     * the change is a single undo step.
      */
     void handleOnIndentMore();
 
     /**
      * Decreases the indent (nesting level) on the current list item or selection.
+     *
+     * All list items in the selection are changed in one edit block, so
+     * the change is a single undo step.
      */
     void handleOnIndentLess();
 
     /**
-     * Changes the style of the current list or creates a new list with
-     * the specified style.
+     * Changes the style of the lists in the selection or creates a new list
+     * with the specified style.
      *
      * @param styleIndex The QTextListStyle of the list.
      */
@@ -132,7 +140,8 @@ private:
     void reformatBoundingItemSpacing();
     QTextCursor topOfSelection();
     QTextCursor bottomOfSelection();
-    void processList(QTextList *list);
+    QVector<QTextBlock> selectedBlocks();
+    void changeIndent(int delta);
     void reformatList(QTextBlock block);
     void reformatList();
 
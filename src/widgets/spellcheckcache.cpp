@@ -0,0 +1,108 @@
+/**
+ * Spell check cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "spellcheckcache_p.h"
+
+#include <QMutexLocker>
+
+//@cond PRIVATE
+
+// Number of words kept, enough for the vocabulary of a lot of mails
+static const int s_maximumWords = 50000;
+
+Q_GLOBAL_STATIC(SpellCheckCache, s_spellCheckCache)
+
+SpellCheckCache::SpellCheckCache()
+    : m_verdicts(s_maximumWords),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+SpellCheckCache *SpellCheckCache::instance()
+{
+    return s_spellCheckCache();
+}
+
+QString SpellCheckCache::key(const QString &language, const QString &word)
+{
+    return language + QLatin1Char('\n') + word;
+}
+
+bool SpellCheckCache::lookup(const QString &language, const QString &word, bool *misspelled)
+{
+    const QString cacheKey = key(language, word);
+    QMutexLocker locker(&m_mutex);
+    // QCache::object() also marks the entry as recently used.
+    const bool *verdict = m_verdicts.object(cacheKey);
+    if (!verdict) {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    *misspelled = *verdict;
+    return true;
+}
+
+void SpellCheckCache::insert(const QString &language, const QString &word, bool misspelled)
+{
+    const QString cacheKey = key(language, word);
+    QMutexLocker locker(&m_mutex);
+    m_verdicts.insert(cacheKey, new bool(misspelled));
+}
+
+void SpellCheckCache::remove(const QString &language, const QString &word)
+{
+    const QString cacheKey = key(language, word);
+    QMutexLocker locker(&m_mutex);
+    m_verdicts.remove(cacheKey);
+    m_generation.ref();
+}
+
+void SpellCheckCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_verdicts.clear();
+    m_generation.ref();
+}
+
+int SpellCheckCache::generation() const
+{
+    return m_generation.loadAcquire();
+}
+
+quint64 SpellCheckCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+quint64 SpellCheckCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+int SpellCheckCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_verdicts.count();
+}
+
+//@endcond
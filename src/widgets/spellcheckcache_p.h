@@ -0,0 +1,90 @@
+/**
+ * Spell check cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef SPELLCHECKCACHE_H
+#define SPELLCHECKCACHE_H
+
+//@cond PRIVATE
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @short Process-wide cache of the verdicts of the spell checker
+ *
+ * All text edits share it, so a word is only looked up once in the
+ * dictionary of a language, no matter how many editors check it. The least
+ * recently used words are dropped when the cache is full. All functions are
+ * thread-safe.
+ *
+ * @internal
+ */
+class SpellCheckCache
+{
+public:
+    SpellCheckCache();
+
+    static SpellCheckCache *instance();
+
+    /**
+     * Looks up @p word in the dictionary @p language.
+     * @return false if the word is not cached, otherwise true and
+     *         @p misspelled is set to the cached verdict
+     */
+    bool lookup(const QString &language, const QString &word, bool *misspelled);
+
+    void insert(const QString &language, const QString &word, bool misspelled);
+
+    /**
+     * Removes the verdict for @p word in the dictionary @p language, for
+     * example after it was ignored or added to the personal dictionary.
+     */
+    void remove(const QString &language, const QString &word);
+
+    /**
+     * Removes all verdicts, for example after words were added to the
+     * personal dictionary.
+     */
+    void clear();
+
+    /**
+     * Incremented whenever verdicts are removed, so that results based on
+     * them can be recognized as outdated.
+     */
+    int generation() const;
+
+    quint64 hits() const;
+    quint64 misses() const;
+    int count() const;
+
+private:
+    static QString key(const QString &language, const QString &word);
+
+    mutable QMutex m_mutex;
+    QCache<QString, bool> m_verdicts;
+    QAtomicInt m_generation;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+//@endcond
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * Spell check worker
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include "spellcheckworker_p.h"
+#include "spellcheckcache_p.h"
+
+#include <QTextBoundaryFinder>
+
+#include <sonnet/speller.h>
+
+//@cond PRIVATE
+
+static bool containsLetter(const QString &text, int start, int length)
+{
+    for (int i = start; i < start + length; ++i) {
+        if (text.at(i).isLetter()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isSkipped(int position, const QVector<int> &skipRanges)
+{
+    for (int i = 0; i + 1 < skipRanges.size(); i += 2) {
+        if (position >= skipRanges.at(i) && position < skipRanges.at(i) + skipRanges.at(i + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SpellCheckWorker::SpellCheckWorker()
+    : QObject(),
+      m_speller(nullptr)
+{
+}
+
+SpellCheckWorker::~SpellCheckWorker()
+{
+    delete m_speller;
+}
+
+void SpellCheckWorker::checkBlock(quint64 ticket, const QString &text, const QVector<int> &skipRanges,
+                                  const QString &language)
+{
+    // Created on first use, so that it belongs to the worker thread.
+    if (!m_speller) {
+        m_speller = new Sonnet::Speller(language);
+    } else if (!language.isEmpty() && m_speller->language() != language) {
+        m_speller->setLanguage(language);
+    }
+
+    SpellCheckCache *cache = SpellCheckCache::instance();
+    const QString dictionary = m_speller->language();
+    int words = 0;
+    int cacheHits = 0;
+    const QVector<int> misspellings = findMisspellings(text, skipRanges,
+    [this, cache, &dictionary, &words, &cacheHits](const QString &word) {
+        ++words;
+        if (m_ignoredWords.contains(word)) {
+            return false;
+        }
+        bool misspelled;
+        if (cache->lookup(dictionary, word, &misspelled)) {
+            ++cacheHits;
+        } else {
+            misspelled = m_speller->isMisspelled(word);
+            cache->insert(dictionary, word, misspelled);
+        }
+        return misspelled;
+    });
+
+    emit blockChecked(ticket, misspellings, words, cacheHits);
+}
+
+void SpellCheckWorker::ignoreWord(const QString &word)
+{
+    m_ignoredWords.insert(word);
+}
+
+QVector<int> SpellCheckWorker::findMisspellings(const QString &text, const QVector<int> &skipRanges,
+                                                const std::function<bool(const QString &)> &isMisspelled)
+{
+    QVector<int> misspellings;
+    QTextBoundaryFinder finder(QTextBoundaryFinder::Word, text);
+    int wordStart = -1;
+    for (int pos = 0; pos != -1; pos = finder.toNextBoundary()) {
+        const QTextBoundaryFinder::BoundaryReasons reasons = finder.boundaryReasons();
+        if (wordStart != -1 && (reasons & QTextBoundaryFinder::EndOfItem)) {
+            const int length = pos - wordStart;
+            if (containsLetter(text, wordStart, length) && !isSkipped(wordStart, skipRanges)
+                    && isMisspelled(text.mid(wordStart, length))) {
+                misspellings << wordStart << length;
+            }
+            wordStart = -1;
+        }
+        if (reasons & QTextBoundaryFinder::StartOfItem) {
+            wordStart = pos;
+        }
+    }
+    return misspellings;
+}
+
+//@endcond
@@ -0,0 +1,93 @@
+/**
+ * Spell check worker
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef SPELLCHECKWORKER_H
+#define SPELLCHECKWORKER_H
+
+//@cond PRIVATE
+
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+#include <functional>
+
+namespace Sonnet
+{
+class Speller;
+}
+
+/**
+ * @short Checks the words of text blocks in a worker thread
+ *
+ * The worker is moved to its own thread and creates its Sonnet::Speller
+ * there. Requests are queued by calling checkBlock() through a queued
+ * connection, each result is reported with the ticket of its request.
+ * Verdicts are shared with all other workers through SpellCheckCache.
+ *
+ * @internal
+ */
+class SpellCheckWorker : public QObject
+{
+    Q_OBJECT
+public:
+    SpellCheckWorker();
+    ~SpellCheckWorker() override;
+
+    /**
+     * Splits @p text into words and checks them with the dictionary for
+     * @p language, or the default dictionary if it is empty. Words starting
+     * in one of the @p skipRanges are not checked.
+     */
+    void checkBlock(quint64 ticket, const QString &text, const QVector<int> &skipRanges,
+                    const QString &language);
+
+    /**
+     * Treats @p word as correctly spelled from now on, like
+     * Sonnet::Highlighter::ignoreWord() does for the speller of the
+     * highlighter.
+     */
+    void ignoreWord(const QString &word);
+
+    /**
+     * Splits @p text into words and returns start and length of each word
+     * for which @p isMisspelled returns true.
+     *
+     * @param skipRanges Start and length of parts of @p text which are not
+     *                   checked
+     */
+    static QVector<int> findMisspellings(const QString &text, const QVector<int> &skipRanges,
+                                         const std::function<bool(const QString &)> &isMisspelled);
+
+Q_SIGNALS:
+    /**
+     * @param misspellings Start and length of each misspelled word
+     * @param words Number of words checked
+     * @param cacheHits Number of words found in SpellCheckCache
+     */
+    void blockChecked(quint64 ticket, const QVector<int> &misspellings, int words, int cacheHits);
+
+private:
+    Sonnet::Speller *m_speller;
+    QSet<QString> m_ignoredWords;
+};
+
+//@endcond
+
+#endif